@@ -0,0 +1,292 @@
+/*
+Hex game and AI - micro-benchmarks of hot paths
+*/
+#include "hex.cpp"
+#include <functional>
+#include <iomanip>
+#include <new>
+
+/******************************************************************************/
+/* allocation counter (replaces the global operator new of this executable) */
+// the replacements are kept out of line, so that the compiler does not pair
+// inlined malloc/free calls with the new/delete expressions of the library
+atomic<long long> allocatedBytes(0); // bytes allocated so far
+
+__attribute__((noinline)) void releaseBytes(void* p) noexcept{free(p);}
+
+__attribute__((noinline)) void* operator new(size_t bytes){
+    allocatedBytes.fetch_add(bytes,memory_order_relaxed);
+    if(void* p = malloc(bytes? bytes : 1)) return p;
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept{releaseBytes(p);}
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept{releaseBytes(p);}
+
+/******************************************************************************/
+/* benchmark harness */
+// each benchmark is warmed up, then timed over a number of samples;
+// a sample runs the operation reps times, reps chosen in warm-up so that a
+// sample takes at least minSampleTime
+struct benchResult{
+    string name; // operation benchmarked
+    int size; // board dimension, num of graph nodes or queue labels
+    int samples; // num of timed samples
+    long long reps; // num of operations per sample
+    double minNs,medianNs,meanNs,stddevNs; // time per operation (ns)
+    long long bytes; // bytes allocated by the first operation
+};
+
+class benchmark{
+private:
+    int samples; // num of timed samples per benchmark
+    double minSampleTime; // minimum time of a sample (s)
+    string filter; // only run benchmarks whose name contains filter
+    string format; // output format: csv or json
+    vector<benchResult> results;
+    long long sink; // results of operations (keeps them from being optimized away)
+public:
+    /**** constructors ****/
+    benchmark(int samples, double minSampleTime, const string& filter, const string& format);
+    /**** accessors ****/
+    bool selected(const string& name);
+    long long getSink();
+    void print();
+    /**** mutators ****/
+    void run(const string& name, int size, function<long long()> op);
+};
+
+/**** constructors ****/
+
+benchmark::benchmark(int samples, double minSampleTime, const string& filter, const string& format){
+    this->samples = max(samples,1);
+    this->minSampleTime = minSampleTime;
+    this->filter = filter;
+    this->format = format;
+    this->sink = 0;
+}
+
+/**** accessors ****/
+
+bool benchmark::selected(const string& name){
+    // check if benchmark name passes the filter
+    return name.find(filter)!=string::npos;
+}
+
+long long benchmark::getSink(){
+    return sink;
+}
+
+void benchmark::print(){
+    // print all results, one line per benchmark
+    cout << fixed << setprecision(1);
+    if(format=="json"){
+        cout << "[\n";
+        for(int i=0; i<results.size(); i++){
+            const benchResult& r = results[i];
+            cout << "  {\"name\":\"" << r.name << "\",\"size\":" << r.size << ",\"samples\":" << r.samples
+            << ",\"reps\":" << r.reps << ",\"min_ns\":" << r.minNs << ",\"median_ns\":" << r.medianNs
+            << ",\"mean_ns\":" << r.meanNs << ",\"stddev_ns\":" << r.stddevNs << ",\"bytes\":" << r.bytes << "}"
+            << (i+1<results.size()? ",\n" : "\n");
+        }
+        cout << "]" << endl;
+        return;
+    }
+    cout << "name,size,samples,reps,min_ns,median_ns,mean_ns,stddev_ns,bytes\n";
+    for(auto& r:results)
+        cout << r.name << ',' << r.size << ',' << r.samples << ',' << r.reps << ','
+        << r.minNs << ',' << r.medianNs << ',' << r.meanNs << ',' << r.stddevNs << ',' << r.bytes << '\n';
+    cout.flush();
+}
+
+/**** mutators ****/
+
+void benchmark::run(const string& name, int size, function<long long()> op){
+    // warm up and time op (skipped if filtered out)
+    if(!selected(name)) return;
+    long long startBytes = allocatedBytes;
+    sink += op();
+    long long bytes = allocatedBytes-startBytes;
+    /**** warm-up: double reps until a batch takes minSampleTime ****/
+    long long reps = 1;
+    while(true){
+        auto startTime = high_resolution_clock::now();
+        for(long long i=0; i<reps; i++) sink += op();
+        double elapsed = duration<double>(high_resolution_clock::now()-startTime).count();
+        if(elapsed>=minSampleTime) break;
+        reps *= 2;
+    }
+    /**** timed samples ****/
+    vector<double> ns(samples);
+    for(int s=0; s<samples; s++){
+        auto startTime = high_resolution_clock::now();
+        for(long long i=0; i<reps; i++) sink += op();
+        ns[s] = duration<double,nano>(high_resolution_clock::now()-startTime).count()/reps;
+    }
+    sort(ns.begin(),ns.end());
+    double mean = 0, var = 0;
+    for(auto t:ns) mean += t;
+    mean /= samples;
+    for(auto t:ns) var += (t-mean)*(t-mean);
+    benchResult r;
+    r.name = name;
+    r.size = size;
+    r.samples = samples;
+    r.reps = reps;
+    r.minNs = ns[0];
+    r.medianNs = (samples%2)? ns[samples/2] : (ns[samples/2-1]+ns[samples/2])/2;
+    r.meanNs = mean;
+    r.stddevNs = (samples>1)? sqrt(var/(samples-1)) : 0;
+    r.bytes = bytes;
+    results.push_back(r);
+}
+
+/******************************************************************************/
+/* fixtures (all from fixed seeds, so runs are comparable across commits) */
+
+void randomPosition(Hex& hex, int size, int stones, uint64_t seed, Bitboard& stones1, Bitboard& stones2){
+    // play stones random moves alternately from player 1 (also recorded in stones1/stones2)
+    mt19937_64 rng(seed);
+    vector<point> empty;
+    for(int x=0; x<size; x++)
+        for(int y=0; y<size; y++) empty.push_back(point(x,y));
+    for(int i=0; i<stones; i++){
+        int k = rng()%empty.size();
+        point p = empty[k];
+        empty[k] = empty.back();
+        empty.pop_back();
+        hex.play(1+i%2,p);
+        if(i%2==0) stones1.set(p);
+        else stones2.set(p);
+    }
+    hex.setPlayer(1+stones%2);
+}
+
+Graph randomGraph(int size, double degree, bool sparse){
+    // random graph with about degree neighbors per node
+    srand(size);
+    Graph g(size,degree/size,1,10);
+    if(sparse) g.makeAdjList();
+    return g;
+}
+
+int main(int argc, char** argv){
+    // options: -r <samples> (timed samples per benchmark), -f <csv|json> (output format),
+    // -b <filter> (run benchmarks whose name contains filter), -t <threads> (workers of MC move)
+    int samples = 10, threads = 1;
+    string format = "csv", filter = "";
+    for(int i=1; i+1<argc; i+=2){
+        string opt = argv[i];
+        if(opt=="-r" && isInt(argv[i+1])) samples = stoi(argv[i+1]);
+        else if(opt=="-t" && isInt(argv[i+1])) threads = stoi(argv[i+1]);
+        else if(opt=="-f") format = argv[i+1];
+        else if(opt=="-b") filter = argv[i+1];
+    }
+    benchmark bench(samples,0.02,filter,format);
+
+    /**** Hex ****/
+    for(int size:{7,11,19}){
+        Hex hex(size);
+        Bitboard stones1(size), stones2(size), reach(size);
+        randomPosition(hex,size,size*size/2,0x4e5,stones1,stones2);
+        bench.run("hex/gameFinished",size,[&](){return hex.gameFinished();});
+        bench.run("hex/hasWon(bitboard)",size,[&](){return hex.hasWon(1,stones1,reach)+hex.hasWon(2,stones2,reach);});
+        bench.run("hex/legalMoves",size,[&](){return hex.legalMoves().size();});
+        bench.run("hex/playUndo",size,[&](){
+            point p = hex.legalMoves().front();
+            hex.play(1,p);
+            hex.undo();
+            return p.x;
+        });
+        Playout kernel(size);
+        kernel.setPosition(stones1,stones2);
+        mt19937_64 rng(0x4e5);
+        bench.run("playout/run",size,[&](){return kernel.run(1,rng);});
+    }
+    for(int size:{7,9,11}){
+        Hex hex(size);
+        Bitboard stones1(size), stones2(size);
+        randomPosition(hex,size,2,0x4e5,stones1,stones2);
+        hex.setSeed(0x4e5);
+        hex.setThreads(threads);
+        hex.setMoveTime(50);
+        hex.setStrategy(1,3);
+        hex.setSolverCells(0); // Monte Carlo search, not the cached endgame solver
+        vector<point> moves = hex.legalMoves();
+        // time-controlled: measures the latency of a 50 ms move (overshoot of the deadline)
+        bench.run("hex/machineMove(MC,50ms)",size,[&](){return hex.machineMove(moves).x;});
+    }
+
+    /**** scaling with board size (memory and time per cell stay flat) ****/
+    for(int size:{11,25,51,101}){
+        Hex hex(size);
+        Bitboard stones1(size), stones2(size);
+        randomPosition(hex,size,size*size/4,0x4e5,stones1,stones2);
+        bench.run("scaling/Hex(size)",size,[&](){
+            Hex h(size);
+            return h.legalMoves().size();
+        });
+        bench.run("scaling/Playout(size)",size,[&](){
+            Playout kernel(size);
+            return kernel.getCells();
+        });
+        Playout kernel(size);
+        mt19937_64 rng(0x4e5);
+        bench.run("scaling/playout",size,[&](){
+            kernel.setPosition(stones1,stones2);
+            return kernel.run(1,rng);
+        });
+        bench.run("scaling/legalMoves",size,[&](){return hex.legalMoves().size();});
+    }
+
+    /**** Graph ****/
+    for(int size:{100,1000}){
+        for(bool sparse:{false,true}){
+            Graph g = randomGraph(size,10,sparse);
+            string storage = sparse? "(csr)" : "(matrix)";
+            bench.run("graph/shortestPathNodes"+storage,size,[&](){
+                int* prev = g.shortestPathNodes(0);
+                int r = prev[size-1];
+                delete[] prev;
+                return r;
+            });
+            bench.run("graph/minSpanningTree"+storage,size,[&](){return g.minSpanningTree(0).size();});
+            bench.run("graph/isConnected"+storage,size,[&](){return g.isConnected();});
+            bench.run("graph/copy"+storage,size,[&](){
+                Graph h(g);
+                return h.getSize();
+            });
+            bench.run("graph/copyAndWrite"+storage,size,[&](){
+                Graph h(g);
+                h.addEdge(0,1); // first write detaches the shared storage
+                return h.getSize();
+            });
+        }
+    }
+
+    /**** priorityQueue ****/
+    for(int size:{100,10000}){
+        vector<double> values(size);
+        mt19937_64 rng(0x4e5);
+        for(auto& v:values) v = static_cast<double>(rng()%1000000);
+        priorityQueue q;
+        q.reserve(size);
+        bench.run("priorityQueue/addPopAll",size,[&](){
+            for(int i=0; i<size; i++) q.add(i,values[i]);
+            long long s = 0;
+            while(!q.isEmpty()) s += q.popHeadNode().label;
+            return s;
+        });
+        bench.run("priorityQueue/chgPriority",size,[&](){
+            for(int i=0; i<size; i++) q.add(i,values[i]);
+            for(int i=0; i<size; i++) q.chgPriority(i,values[size-1-i]);
+            long long s = q.peekHeadNode().label;
+            q.clear();
+            return s;
+        });
+    }
+
+    bench.print();
+    if(bench.getSink()==42) cerr << endl; // use sink
+    return 0;
+}
@@ -0,0 +1,229 @@
+#ifndef BITBOARD
+#define BITBOARD
+#include "stats.cpp"
+
+/******************************************************************************/
+/* bitboard (one bit per board point, rows padded to 64-bit words) */
+class Bitboard{
+private:
+    int size; // dimension of board
+    int words; // words per row
+    uint64_t lastMask; // valid bits in the last word of a row
+    vector<uint64_t> bits; // row-major words, bit j of a row is column j
+    // helper functions
+    uint64_t* row(int x){return &bits[x*words];}
+    const uint64_t* row(int x) const{return &bits[x*words];}
+    void spreadRow(uint64_t* r, const uint64_t* mask) const;
+public:
+    /**** constructors ****/
+    Bitboard();
+    Bitboard(int size);
+    /**** accessors ****/
+    int getSize() const;
+    int getWords() const;
+    const uint64_t* getRow(int x) const;
+    bool test(const point& p) const;
+    bool any() const;
+    bool intersects(const Bitboard& b) const;
+    int count() const;
+    vector<point> toPoints() const;
+    Bitboard complement() const;
+    /**** mutators ****/
+    void set(const point& p);
+    void reset(const point& p);
+    void clear();
+    void fillRow(int x);
+    void fillColumn(int y);
+    Bitboard& operator|=(const Bitboard& b);
+    Bitboard& operator&=(const Bitboard& b);
+    /**** algorithms ****/
+    void floodFill(Bitboard& reach) const;
+    bool connects(const Bitboard& start, const Bitboard& end, Bitboard& reach) const;
+};
+
+inline Bitboard operator|(Bitboard b1, const Bitboard& b2){return b1 |= b2;}
+inline Bitboard operator&(Bitboard b1, const Bitboard& b2){return b1 &= b2;}
+
+/**** constructors ****/
+
+Bitboard::Bitboard():size(0),words(0),lastMask(0){}
+
+Bitboard::Bitboard(int size){
+    // construct empty bitboard of size*size points
+    this->size = size;
+    this->words = (size+63)/64;
+    this->lastMask = (size%64==0)? ~0ULL : (1ULL<<(size%64))-1;
+    bits.assign(size*words,0);
+    STATS_COUNT(statAllocations,1);
+}
+
+/**** accessors ****/
+
+int Bitboard::getSize() const{
+    // dimension of board
+    return size;
+}
+
+int Bitboard::getWords() const{
+    // number of words per row
+    return words;
+}
+
+const uint64_t* Bitboard::getRow(int x) const{
+    // words of row x
+    return row(x);
+}
+
+bool Bitboard::test(const point& p) const{
+    // check if point p is set
+    return (row(p.x)[p.y/64]>>(p.y%64))&1;
+}
+
+bool Bitboard::any() const{
+    // check if any point is set
+    for(auto w:bits) if(w) return true;
+    return false;
+}
+
+bool Bitboard::intersects(const Bitboard& b) const{
+    // check if any point is set in both bitboards
+    for(int i=0; i<bits.size(); i++) if(bits[i]&b.bits[i]) return true;
+    return false;
+}
+
+int Bitboard::count() const{
+    // number of set points
+    int n = 0;
+    for(auto w:bits) n += __builtin_popcountll(w);
+    return n;
+}
+
+vector<point> Bitboard::toPoints() const{
+    // set points in row-major order
+    vector<point> points;
+    for(int x=0; x<size; x++)
+        for(int k=0; k<words; k++)
+            for(uint64_t w=row(x)[k]; w; w&=w-1)
+                points.push_back(point(x,64*k+__builtin_ctzll(w)));
+    return points;
+}
+
+Bitboard Bitboard::complement() const{
+    // points not set (within board)
+    Bitboard b(*this);
+    for(int x=0; x<size; x++){
+        uint64_t* r = b.row(x);
+        for(int k=0; k<words; k++) r[k] = ~r[k];
+        r[words-1] &= lastMask;
+    }
+    return b;
+}
+
+/**** mutators ****/
+
+void Bitboard::set(const point& p){
+    // set point p
+    row(p.x)[p.y/64] |= 1ULL<<(p.y%64);
+}
+
+void Bitboard::reset(const point& p){
+    // unset point p
+    row(p.x)[p.y/64] &= ~(1ULL<<(p.y%64));
+}
+
+void Bitboard::clear(){
+    // unset all points
+    fill(bits.begin(),bits.end(),0);
+}
+
+void Bitboard::fillRow(int x){
+    // set all points in row x
+    uint64_t* r = row(x);
+    for(int k=0; k<words; k++) r[k] = ~0ULL;
+    r[words-1] = lastMask;
+}
+
+void Bitboard::fillColumn(int y){
+    // set all points in column y
+    for(int x=0; x<size; x++) row(x)[y/64] |= 1ULL<<(y%64);
+}
+
+Bitboard& Bitboard::operator|=(const Bitboard& b){
+    for(int i=0; i<bits.size(); i++) bits[i] |= b.bits[i];
+    return *this;
+}
+
+Bitboard& Bitboard::operator&=(const Bitboard& b){
+    for(int i=0; i<bits.size(); i++) bits[i] &= b.bits[i];
+    return *this;
+}
+
+/**** algorithms ****/
+
+void Bitboard::spreadRow(uint64_t* r, const uint64_t* mask) const{
+    // spread set bits of row r sideways within mask, until saturated
+    bool changed = true;
+    while(changed){
+        changed = false;
+        uint64_t carry = 0;
+        for(int k=0; k<words; k++){ // shift towards higher columns
+            uint64_t w = (r[k]|(r[k]<<1)|carry)&mask[k];
+            carry = r[k]>>63;
+            if(w!=r[k]){r[k] = w; changed = true;}
+        }
+        carry = 0;
+        for(int k=words-1; k>=0; k--){ // shift towards lower columns
+            uint64_t w = (r[k]|(r[k]>>1)|carry)&mask[k];
+            carry = r[k]<<63;
+            if(w!=r[k]){r[k] = w; changed = true;}
+        }
+    }
+}
+
+void Bitboard::floodFill(Bitboard& reach) const{
+    // grow reach along set points of this bitboard (hex adjacency), in place
+    // row x touches row x-1 at columns y,y+1 and row x+1 at columns y-1,y
+    STATS_COUNT(statGraphSearches,1);
+    bool changed = true;
+    reach &= *this;
+    while(changed){
+        changed = false;
+        for(int x=0; x<size; x++){ // downward sweep
+            uint64_t* r = reach.row(x);
+            const uint64_t* mask = row(x);
+            if(x>0){
+                const uint64_t* up = reach.row(x-1);
+                for(int k=0; k<words; k++){
+                    uint64_t carry = (k+1<words)? up[k+1]<<63 : 0;
+                    uint64_t w = (r[k]|up[k]|(up[k]>>1)|carry)&mask[k];
+                    if(w!=r[k]){r[k] = w; changed = true;}
+                }
+            }
+            spreadRow(r,mask);
+        }
+        for(int x=size-2; x>=0; x--){ // upward sweep
+            uint64_t* r = reach.row(x);
+            const uint64_t* mask = row(x);
+            const uint64_t* down = reach.row(x+1);
+            bool rowChanged = false;
+            for(int k=0; k<words; k++){
+                uint64_t carry = (k>0)? down[k-1]>>63 : 0;
+                uint64_t w = (r[k]|down[k]|(down[k]<<1)|carry)&mask[k];
+                if(w!=r[k]){r[k] = w; rowChanged = true;}
+            }
+            if(rowChanged){
+                spreadRow(r,mask);
+                changed = true;
+            }
+        }
+    }
+}
+
+bool Bitboard::connects(const Bitboard& start, const Bitboard& end, Bitboard& reach) const{
+    // check if set points link start to end, using reach as workspace
+    reach = start;
+    floodFill(reach);
+    return reach.intersects(end);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef BOOK
+#define BOOK
+#include "util.cpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/******************************************************************************/
+/* opening book (sorted binary file of position keys, memory-mapped for lookup) */
+// file layout: bookHeader, then header.entries bookEntry records sorted by key.
+// Keys are Zobrist hashes of the position (fixed per board size) with the
+// player to move mixed in, so a book only answers boards of its own size.
+struct bookHeader{
+    char magic[8]; // "HEXBOOK1"
+    uint32_t size; // dimension of board
+    uint32_t entries; // num of entries
+};
+
+struct bookEntry{
+    uint64_t key; // position key (see openingBook::positionKey)
+    int32_t move; // graph node of the book move
+    int32_t stones; // num of stones on board (ply of the position)
+};
+
+const char bookMagic[8] = {'H','E','X','B','O','O','K','1'};
+
+class openingBook{
+private:
+    int size; // dimension of board (0 if not open)
+    size_t entries; // num of entries
+    const bookEntry* entry; // first entry (in mapped file)
+    void* mapped; // mapped file (0 if not open)
+    size_t bytes; // length of mapped file
+public:
+    /**** constructors ****/
+    openingBook();
+    openingBook(const openingBook&) = delete;
+    openingBook& operator=(const openingBook&) = delete;
+    /**** destructor ****/
+    ~openingBook();
+    /**** accessors ****/
+    bool isOpen();
+    int getSize();
+    size_t getEntries();
+    int lookup(uint64_t key);
+    static uint64_t positionKey(uint64_t hashKey, int player);
+    /**** mutators ****/
+    bool open(const string& path, int size);
+    void close();
+    static bool write(const string& path, int size, vector<bookEntry>& entries);
+};
+
+/**** constructors ****/
+
+openingBook::openingBook():size(0),entries(0),entry(0),mapped(0),bytes(0){}
+
+/**** destructor ****/
+
+openingBook::~openingBook(){
+    close();
+}
+
+/**** accessors ****/
+
+bool openingBook::isOpen(){
+    return mapped!=0;
+}
+
+int openingBook::getSize(){
+    return size;
+}
+
+size_t openingBook::getEntries(){
+    return entries;
+}
+
+int openingBook::lookup(uint64_t key){
+    // book move (graph node) of position key, -1 if not in book (binary search)
+    size_t lo = 0, hi = entries;
+    while(lo<hi){
+        size_t mid = (lo+hi)/2;
+        if(entry[mid].key<key) lo = mid+1;
+        else hi = mid;
+    }
+    if(lo<entries && entry[lo].key==key) return entry[lo].move;
+    return -1;
+}
+
+uint64_t openingBook::positionKey(uint64_t hashKey, int player){
+    // key of a position: Zobrist hash with the player to move mixed in
+    return (player==2)? hashKey^splitmix64(0x5eed2ULL) : hashKey;
+}
+
+/**** mutators ****/
+
+bool openingBook::open(const string& path, int size){
+    // map book file of path for board size (returns false if missing or for another size)
+    close();
+    int fd = ::open(path.c_str(),O_RDONLY);
+    if(fd<0) return false;
+    struct stat st;
+    if(fstat(fd,&st)<0 || static_cast<size_t>(st.st_size)<sizeof(bookHeader)){
+        ::close(fd);
+        return false;
+    }
+    bytes = st.st_size;
+    mapped = mmap(0,bytes,PROT_READ,MAP_PRIVATE,fd,0);
+    ::close(fd); // mapping stays valid
+    if(mapped==MAP_FAILED){
+        mapped = 0;
+        return false;
+    }
+    const bookHeader* header = static_cast<const bookHeader*>(mapped);
+    if(memcmp(header->magic,bookMagic,8)!=0 || static_cast<int>(header->size)!=size
+    || bytes<sizeof(bookHeader)+header->entries*sizeof(bookEntry)){
+        close();
+        return false;
+    }
+    this->size = size;
+    this->entries = header->entries;
+    this->entry = reinterpret_cast<const bookEntry*>(static_cast<const char*>(mapped)+sizeof(bookHeader));
+    return true;
+}
+
+void openingBook::close(){
+    // unmap book file
+    if(mapped) munmap(mapped,bytes);
+    mapped = 0;
+    entry = 0;
+    size = 0;
+    entries = bytes = 0;
+}
+
+bool openingBook::write(const string& path, int size, vector<bookEntry>& entries){
+    // write book file of board size (entries are sorted by key, duplicates dropped)
+    sort(entries.begin(),entries.end(),[](const bookEntry& a, const bookEntry& b){return a.key<b.key;});
+    entries.erase(unique(entries.begin(),entries.end(),[](const bookEntry& a, const bookEntry& b){return a.key==b.key;}),entries.end());
+    bookHeader header;
+    memcpy(header.magic,bookMagic,8);
+    header.size = size;
+    header.entries = entries.size();
+    ofstream file(path,ios::binary|ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()),entries.size()*sizeof(bookEntry));
+    return static_cast<bool>(file);
+}
+
+#endif
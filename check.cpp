@@ -0,0 +1,524 @@
+/*
+Hex game and AI - soundness checks of search pruning and core data structures
+*/
+#include "hex.cpp"
+#include <unordered_map>
+
+/******************************************************************************/
+/* brute force (exhaustive negamax over small boards, one bit per point) */
+// independent of the engine: stones are bit masks of size*size <= 64 bits,
+// connections are found by a plain breadth-first search
+class bruteForce{
+private:
+    int size; // dimension of board
+    vector<uint64_t> around; // mask of the neighbors of each point
+    unordered_map<uint64_t,bool> memo[3]; // value of each position for player 1 and 2 to move
+    uint64_t hash(uint64_t stones1, uint64_t stones2);
+public:
+    /**** constructors ****/
+    bruteForce(int size);
+    /**** accessors ****/
+    bool connects(int id, uint64_t stones);
+    /**** algorithms ****/
+    bool wins(int id, uint64_t stones1, uint64_t stones2);
+    vector<point> winningMoves(int id, uint64_t stones1, uint64_t stones2);
+};
+
+/**** constructors ****/
+
+bruteForce::bruteForce(int size):around(size*size,0){
+    this->size = size;
+    const vector<point> neighborVec{point(0,1),point(-1,1),point(-1,0),point(0,-1),point(1,-1),point(1,0)};
+    for(int x=0; x<size; x++)
+        for(int y=0; y<size; y++)
+            for(auto v:neighborVec){
+                point q = point(x,y)+v;
+                if(q.x>=0 && q.x<size && q.y>=0 && q.y<size) around[size*x+y] |= 1ULL<<(size*q.x+q.y);
+            }
+}
+
+/**** helper functions ****/
+
+uint64_t bruteForce::hash(uint64_t stones1, uint64_t stones2){
+    // key of a position in memo
+    return splitmix64(stones1)^(stones2*0x9e3779b97f4a7c15ULL);
+}
+
+/**** accessors ****/
+
+bool bruteForce::connects(int id, uint64_t stones){
+    // check if stones of player id link its edges (1: row 0 to row size-1, 2: column 0 to column size-1)
+    uint64_t start = 0, end = 0;
+    for(int i=0; i<size; i++){
+        start |= 1ULL<<((id==1)? i : size*i);
+        end |= 1ULL<<((id==1)? size*(size-1)+i : size*i+size-1);
+    }
+    uint64_t reach = stones&start, frontier = reach;
+    while(frontier){
+        uint64_t next = 0;
+        for(uint64_t f=frontier; f; f&=f-1) next |= around[__builtin_ctzll(f)];
+        frontier = next&stones&~reach;
+        reach |= frontier;
+    }
+    return (reach&end)!=0;
+}
+
+/**** algorithms ****/
+
+bool bruteForce::wins(int id, uint64_t stones1, uint64_t stones2){
+    // check if player id to move wins (no player has won yet)
+    uint64_t key = hash(stones1,stones2);
+    auto it = memo[id].find(key);
+    if(it!=memo[id].end()) return it->second;
+    bool win = false;
+    uint64_t empty = ~(stones1|stones2)&((size*size==64)? ~0ULL : (1ULL<<(size*size))-1);
+    for(uint64_t e=empty; e && !win; e&=e-1){
+        uint64_t b = e&-e;
+        uint64_t s1 = (id==1)? stones1|b : stones1, s2 = (id==2)? stones2|b : stones2;
+        win = connects(id,(id==1)? s1 : s2) || !wins(1+id%2,s1,s2);
+    }
+    memo[id][key] = win;
+    return win;
+}
+
+vector<point> bruteForce::winningMoves(int id, uint64_t stones1, uint64_t stones2){
+    // all moves that win for player id to move
+    vector<point> moves;
+    for(int n=0; n<size*size; n++){
+        uint64_t b = 1ULL<<n;
+        if((stones1|stones2)&b) continue;
+        uint64_t s1 = (id==1)? stones1|b : stones1, s2 = (id==2)? stones2|b : stones2;
+        if(connects(id,(id==1)? s1 : s2) || !wins(1+id%2,s1,s2)) moves.push_back(point(n/size,n%size));
+    }
+    return moves;
+}
+
+/******************************************************************************/
+/* checks */
+
+struct checkResult{
+    string name; // property checked
+    long long checked,failed; // num of cases checked and failed
+};
+
+struct position{
+    // random position with its board string and bit masks
+    int size; // dimension of board
+    int player; // player to move
+    string board; // row-major cells of X, O or . (as in Hex::setPosition)
+    uint64_t stones1,stones2; // stones of player 1 and 2
+    Bitboard bits1,bits2; // stones of player 1 and 2
+};
+
+position randomPosition(int size, int maxEmpty, mt19937_64& rng, bruteForce& brute){
+    // random unfinished position with at most maxEmpty empty points, alternating stones from player 1
+    while(true){
+        position pos{size,1,string(size*size,'.'),0,0,Bitboard(size),Bitboard(size)};
+        vector<int> cells(size*size);
+        iota(cells.begin(),cells.end(),0);
+        shuffle(cells.begin(),cells.end(),rng);
+        int low = max(size*size-maxEmpty,0);
+        int stones = low+rng()%(size*size-low);
+        for(int i=0; i<stones; i++){
+            int n = cells[i];
+            pos.board[n] = (i%2==0)? 'X' : 'O';
+            ((i%2==0)? pos.stones1 : pos.stones2) |= 1ULL<<n;
+            ((i%2==0)? pos.bits1 : pos.bits2).set(point(n/size,n%size));
+        }
+        pos.player = 1+stones%2; // fewer stones, player 1 if equal
+        if(!brute.connects(1,pos.stones1) && !brute.connects(2,pos.stones2)) return pos;
+    }
+}
+
+void setPosition(Hex& hex, const position& pos){
+    // set up pos on hex, taking back the previous position (keeps its tables)
+    for(int stones=pos.size*pos.size-hex.legalMoves().size(); stones>0; stones--) hex.undo();
+    hex.setPosition(pos.board);
+}
+
+bool contains(const vector<point>& moves, const point& p){
+    return find(moves.begin(),moves.end(),p)!=moves.end();
+}
+
+checkResult checkSolver(int positions, mt19937_64& rng){
+    // proof-number solver: result and winning move match brute force,
+    // with the proof table kept across positions
+    checkResult r{"solver vs brute force",0,0};
+    for(int size:{3,4,5}){
+        bruteForce brute(size);
+        Hex hex(size);
+        hex.setMoveTime(0);
+        for(int i=0; i<positions; i++){
+            position pos = randomPosition(size,12,rng,brute);
+            setPosition(hex,pos);
+            point move;
+            int result = hex.solvePosition(move);
+            vector<point> wins = brute.winningMoves(pos.player,pos.stones1,pos.stones2);
+            bool ok = (result==1)? contains(wins,move) : (result==-1)? wins.empty() : false;
+            r.checked++;
+            if(!ok){
+                r.failed++;
+                cout << "  solver: " << size << "*" << size << " " << pos.board << " result " << result << endl;
+            }
+        }
+    }
+    return r;
+}
+
+checkResult checkMustPlay(int positions, mt19937_64& rng){
+    // H-search: a proven connection wins, and the must-play region keeps every winning move
+    checkResult r{"H-search vs brute force",0,0};
+    for(int size:{3,4,5}){
+        bruteForce brute(size);
+        Hex hex(size);
+        for(int i=0; i<positions; i++){
+            position pos = randomPosition(size,12,rng,brute);
+            setPosition(hex,pos);
+            vector<point> moves = hex.legalMoves();
+            int result = hex.mustPlay(pos.player,moves);
+            vector<point> wins = brute.winningMoves(pos.player,pos.stones1,pos.stones2);
+            bool ok = (result==-1)? wins.empty() : (result==1)? contains(wins,moves[0]) : true;
+            for(auto p:wins) ok = ok && (result==1 || contains(moves,p));
+            r.checked++;
+            if(!ok){
+                r.failed++;
+                cout << "  H-search: " << size << "*" << size << " " << pos.board << " result " << result << endl;
+            }
+        }
+    }
+    return r;
+}
+
+checkResult checkInferior(int positions, mt19937_64& rng){
+    // inferior cells: fill-in keeps the value of the position,
+    // and pruning keeps a winning move if there is one
+    checkResult r{"inferior cells vs brute force",0,0};
+    for(int size:{3,4,5}){
+        bruteForce brute(size);
+        InferiorCells inferior(size);
+        for(int i=0; i<positions; i++){
+            position pos = randomPosition(size,12,rng,brute);
+            inferior.analyse(pos.bits1,pos.bits2);
+            uint64_t filled1 = pos.stones1, filled2 = pos.stones2;
+            vector<point> moves;
+            for(int n=0; n<size*size; n++){
+                point p(n/size,n%size);
+                if(inferior.getFilled(1).test(p)) filled1 |= 1ULL<<n;
+                if(inferior.getFilled(2).test(p)) filled2 |= 1ULL<<n;
+                if(!pos.bits1.test(p) && !pos.bits2.test(p)) moves.push_back(p);
+            }
+            inferior.prune(pos.player,moves);
+            bool win = brute.wins(pos.player,pos.stones1,pos.stones2);
+            bool ok = brute.connects(1,filled1) || brute.connects(2,filled2)
+            ? brute.connects(pos.player,(pos.player==1)? filled1 : filled2)==win
+            : brute.wins(pos.player,filled1,filled2)==win;
+            vector<point> wins = brute.winningMoves(pos.player,pos.stones1,pos.stones2);
+            ok = ok && (wins.empty() || any_of(moves.begin(),moves.end(),[&](const point& p){return contains(wins,p);}));
+            r.checked++;
+            if(!ok){
+                r.failed++;
+                cout << "  inferior: " << size << "*" << size << " " << pos.board << endl;
+            }
+        }
+    }
+    return r;
+}
+
+template<int N>
+void checkFixedFinish(int fills, mt19937_64& rng, checkResult& r){
+    // fixed-size playout finish of dimension N on random fills
+    Bitboard stones1(N), filled(N), reach(N), north(N), south(N);
+    north.fillRow(0);
+    south.fillRow(N-1);
+    vector<point> cells;
+    for(int i=0; i<fills; i++){
+        stones1.clear();
+        cells.clear();
+        for(int x=0; x<N; x++)
+            for(int y=0; y<N; y++){
+                int c = rng()%3; // player 1, player 2 or empty
+                if(c==0) stones1.set(point(x,y));
+                else if(c==2) cells.push_back(point(x,y));
+            }
+        int first = rng()%2;
+        filled = stones1;
+        for(int k=first; k<static_cast<int>(cells.size()); k+=2) filled.set(cells[k]);
+        int expected = filled.connects(north,south,reach)? 1 : 2;
+        r.checked++;
+        if(fixedFinish<N>(stones1,cells.data(),cells.size(),first)!=expected){
+            r.failed++;
+            cout << "  fixedFinish<" << N << ">: fill " << i << endl;
+        }
+    }
+}
+
+checkResult checkPlayout(int fills, mt19937_64& rng){
+    // fixed-size playout finish: same winner as the bitboard flood fill
+    checkResult r{"fixedFinish vs flood fill",0,0};
+    checkFixedFinish<5>(fills,rng,r);
+    checkFixedFinish<7>(fills,rng,r);
+    checkFixedFinish<9>(fills,rng,r);
+    checkFixedFinish<11>(fills,rng,r);
+    checkFixedFinish<13>(fills,rng,r);
+    checkFixedFinish<19>(fills,rng,r);
+    return r;
+}
+
+checkResult checkHeap(int rounds, mt19937_64& rng){
+    // indexed 4-ary heap: after random adds, priority changes and deletions, nodes pop in
+    // the order of a sort by priority (ties: the one queued first)
+    checkResult r{"priorityQueue vs sort",0,0};
+    priorityQueue q;
+    for(int round=0; round<rounds; round++){
+        int labels = 1+rng()%200;
+        vector<double> value(labels);
+        vector<long> queued(labels,-1); // time each label was last queued (-1 if absent)
+        long now = 0;
+        for(int op=0; op<3*labels; op++){
+            int label = rng()%labels;
+            double v = rng()%20; // few values, so ties are common
+            int kind = rng()%4;
+            if(kind==3){
+                q.del(label);
+                queued[label] = -1;
+            }else if(queued[label]<0){
+                q.add(label,v);
+                value[label] = v;
+                queued[label] = now++;
+            }else{
+                q.chgPriority(label,v);
+                value[label] = v;
+                queued[label] = now++;
+            }
+        }
+        vector<int> expected;
+        for(int label=0; label<labels; label++) if(queued[label]>=0) expected.push_back(label);
+        sort(expected.begin(),expected.end(),[&](int a, int b){
+            return (value[a]!=value[b])? value[a]>value[b] : queued[a]<queued[b];
+        });
+        bool ok = q.getSize()==static_cast<int>(expected.size());
+        for(int label:expected) ok = ok && !q.isEmpty() && q.popHeadNode().label==label;
+        q.clear();
+        r.checked++;
+        if(!ok){
+            r.failed++;
+            cout << "  priorityQueue: round " << round << endl;
+        }
+    }
+    return r;
+}
+
+struct graphModel{
+    // plain adjacency and cost matrices that a Graph must agree with
+    int size;
+    vector<vector<double>> cost; // cost of each edge, -1 if not adjacent
+    graphModel(int size):size(size),cost(size,vector<double>(size,-1)){}
+    void apply(Graph& g, mt19937_64& rng){
+        // one random addEdge, deleteEdge or setCost, on g and on the model
+        int n = rng()%size, m = rng()%size;
+        if(n==m) return;
+        int kind = rng()%3;
+        if(kind==0){
+            g.addEdge(n,m);
+            if(cost[n][m]<0) cost[n][m] = cost[m][n] = 0;
+        }else if(kind==1){
+            g.deleteEdge(n,m);
+            cost[n][m] = cost[m][n] = -1;
+        }else if(cost[n][m]>=0){ // costs of edges only
+            double c = 1+rng()%9;
+            g.setCost(n,m,c);
+            cost[n][m] = cost[m][n] = c;
+        }
+    }
+    bool agrees(Graph& g){
+        // check edges, costs and neighbor lists of g
+        int edges = 0;
+        for(int n=0; n<size; n++){
+            vector<int> nbors = g.getNeighbors(n), expected;
+            for(int m=0; m<size; m++){
+                bool adjacent = cost[n][m]>=0;
+                if(adjacent) expected.push_back(m);
+                if(g.isAdjacent(n,m)!=adjacent || (adjacent && g.getCost(n,m)!=cost[n][m])) return false;
+                edges += adjacent && m>n;
+            }
+            sort(nbors.begin(),nbors.end());
+            if(nbors!=expected) return false;
+        }
+        return g.getEdges()==edges;
+    }
+};
+
+checkResult checkGraph(int rounds, mt19937_64& rng){
+    // Graph in matrix and CSR storage: copies share storage until written, and a write to
+    // a copy (including CSR growth beyond the reserved slots) leaves the other graphs unchanged
+    checkResult r{"Graph copy-on-write vs model",0,0};
+    for(int round=0; round<rounds; round++){
+        int size = 2+rng()%30;
+        bool sparse = round%2;
+        Graph g(size,sparse,2);
+        graphModel model(size);
+        for(int op=0; op<4*size; op++) model.apply(g,rng);
+        Graph copy(g), assigned(1,sparse,2);
+        assigned = copy;
+        graphModel copyModel = model;
+        bool ok = g.isShared() && copy.isShared() && model.agrees(copy);
+        for(int op=0; op<4*size; op++) copyModel.apply(copy,rng);
+        Graph moved(move(assigned));
+        ok = ok && model.agrees(g) && copyModel.agrees(copy) && model.agrees(moved) && moved.isShared();
+        r.checked++;
+        if(!ok){
+            r.failed++;
+            cout << "  Graph: round " << round << (sparse? " (csr)" : " (matrix)") << endl;
+        }
+    }
+    return r;
+}
+
+checkResult checkUndo(int rounds, mt19937_64& rng){
+    // reversible moves: the disjoint set rolls back to any checkpoint, and undoing the moves
+    // of a game restores legal moves (in order) and game state after each earlier move
+    checkResult r{"undo and rollback round trip",0,0};
+    for(int round=0; round<rounds; round++){
+        bool ok = true;
+        /**** disjoint set against a replay of the unions up to each checkpoint ****/
+        int elements = 2+rng()%40;
+        disjointSet sets(elements);
+        vector<pair<int,int>> unions;
+        vector<pair<int,int>> marks; // checkpoint of sets and num of unions at it
+        for(int op=0; op<4*elements; op++){
+            if(rng()%5==0) marks.push_back(make_pair(sets.checkpoint(),static_cast<int>(unions.size())));
+            else if(rng()%7==0 && !marks.empty()){
+                sets.rollback(marks.back().first);
+                unions.resize(marks.back().second);
+                marks.pop_back();
+            }else{
+                unions.push_back(make_pair(rng()%elements,rng()%elements));
+                sets.unite(unions.back().first,unions.back().second);
+            }
+            disjointSet replay(elements);
+            for(auto u:unions) replay.unite(u.first,u.second);
+            for(int n=0; n<elements && ok; n++)
+                for(int m=n+1; m<elements && ok; m++) ok = sets.isConnected(n,m)==replay.isConnected(n,m);
+        }
+        /**** play a random game, then take it back move by move ****/
+        int size = 2+rng()%7;
+        bruteForce brute(size);
+        Hex hex(size);
+        vector<vector<point>> legal; // legal moves before each move
+        uint64_t stones[3] = {0,0,0};
+        for(int id=1; !hex.gameFinished(); id=1+id%2){
+            vector<point> moves = hex.legalMoves();
+            legal.push_back(moves);
+            point p = moves[rng()%moves.size()];
+            hex.play(id,p);
+            stones[id] |= 1ULL<<(size*p.x+p.y);
+            ok = ok && hex.gameFinished()==brute.connects(id,stones[id]) && hex.occupant(p)==id;
+        }
+        for(int k=legal.size()-1; k>=0; k--){
+            hex.undo();
+            ok = ok && hex.legalMoves()==legal[k] && !hex.gameFinished();
+        }
+        r.checked++;
+        if(!ok){
+            r.failed++;
+            cout << "  undo: round " << round << endl;
+        }
+    }
+    return r;
+}
+
+checkResult checkRecords(int records, mt19937_64& rng){
+    // game record file: records written and appended by a second writer read back unchanged,
+    // skip steps over them, a truncated record ends the scan, and other files are refused
+    checkResult r{"game records round trip",0,0};
+    char path[] = "/tmp/hexcheckXXXXXX";
+    int fd = mkstemp(path);
+    if(fd<0){
+        cout << "  records: cannot create a temporary file" << endl;
+        r.failed++;
+        return r;
+    }
+    close(fd);
+    vector<gameRecord> written(records);
+    for(int i=0; i<records; i++){
+        gameRecord& g = written[i];
+        g.size = 1+rng()%200; // up to two-byte varints
+        g.firstPlayer = 1+rng()%2;
+        g.winner = rng()%3;
+        g.strategy[0] = 0;
+        g.strategy[1] = rng()%(strategyCount+1);
+        g.strategy[2] = rng()%(strategyCount+1);
+        g.ms[0] = 0;
+        g.ms[1] = rng()%(1LL<<(rng()%40));
+        g.ms[2] = rng()%(1LL<<(rng()%40));
+        g.moves.resize(rng()%min(g.size*g.size+1,300));
+        for(auto& m:g.moves) m = rng()%(g.size*g.size);
+    }
+    {
+        recordWriter first, second; // the second appends to the file of the first
+        bool ok = first.open(path);
+        for(int i=0; i<records/2; i++) first.write(written[i]);
+        ok = ok && second.open(path);
+        for(int i=records/2; i<records; i++) second.write(written[i]);
+        if(!ok) r.failed++;
+    }
+    recordReader reader;
+    gameRecord g;
+    bool ok = reader.open(path);
+    for(int i=0; i<records && ok; i++){
+        if(i%3==2){
+            ok = reader.skip();
+            continue;
+        }
+        const gameRecord& w = written[i];
+        ok = reader.read(g) && g.size==w.size && g.firstPlayer==w.firstPlayer && g.winner==w.winner
+        && g.strategy[1]==w.strategy[1] && g.strategy[2]==w.strategy[2] && g.ms[1]==w.ms[1] && g.ms[2]==w.ms[2]
+        && g.moves==w.moves;
+        r.checked++;
+        if(!ok) cout << "  records: record " << i << endl;
+    }
+    ok = ok && !reader.read(g) && !reader.skip(); // end of file
+    /**** a truncated last record ends the scan, a file without the magic is refused ****/
+    size_t bytes = reader.getBytes();
+    reader.close();
+    ok = ok && truncate(path,bytes-1)==0 && reader.open(path);
+    for(int i=0; i<records-1 && ok; i++) ok = reader.skip();
+    ok = ok && !reader.read(g);
+    reader.close();
+    ofstream(path,ios::binary) << "not a record file";
+    recordWriter writer;
+    ok = ok && !reader.open(path) && !writer.open(path);
+    unlink(path);
+    r.checked++;
+    if(!ok) r.failed++;
+    return r;
+}
+
+int main(int argc, char** argv){
+    // options: -p <positions> (random positions per board size and check, fills per
+    // dimension x 100 for fixedFinish), -s <seed> (seed of the random positions)
+    // exit status 1 if any check fails
+    int positions = 100;
+    uint64_t seed = 1;
+    for(int i=1; i+1<argc; i+=2){
+        string opt = argv[i];
+        if(opt=="-p" && isInt(argv[i+1])) positions = stoi(argv[i+1]);
+        else if(opt=="-s" && isInt(argv[i+1])) seed = stoull(argv[i+1]);
+    }
+    mt19937_64 rng(seed);
+    vector<checkResult> results;
+    results.push_back(checkSolver(positions,rng));
+    results.push_back(checkMustPlay(positions,rng));
+    results.push_back(checkInferior(positions,rng));
+    results.push_back(checkPlayout(100*positions,rng));
+    results.push_back(checkHeap(10*positions,rng));
+    results.push_back(checkGraph(10*positions,rng));
+    results.push_back(checkUndo(positions,rng));
+    results.push_back(checkRecords(10*positions,rng));
+    bool passed = true;
+    for(auto& r:results){
+        cout << r.name << ": " << r.checked << " checked, " << r.failed << " failed" << endl;
+        passed = passed && r.failed==0;
+    }
+    return passed? 0 : 1;
+}
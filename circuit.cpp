@@ -0,0 +1,162 @@
+#ifndef CIRCUIT
+#define CIRCUIT
+#include "bitboard.cpp"
+
+/******************************************************************************/
+/* resistance circuit of a player's connection (evaluation function) */
+// each board point is a resistor: 0 (own stone, approximated by ownResistance),
+// 1 (empty) or infinite (opponent stone). Adjacent points are wired in series,
+// the player's two edges are the terminals. The edge-to-edge resistance is found
+// by solving the Laplacian system with Jacobi-preconditioned conjugate gradient.
+class Circuit{
+private:
+    int size; // dimension of board
+    int cells; // num of board points
+    int iterations; // CG iterations of the last solve
+    static constexpr double ownResistance=0.05; // resistance of own stone (0 would make the system singular)
+    static constexpr double tolerance=1e-5; // relative residual to stop CG
+    vector<int> nbor; // neighbor table, 6 entries per point (-1 if off board)
+    vector<double> resist; // resistance of each point (-1 if infinite)
+    vector<double> conductance; // conductance of each neighbor link, 6 entries per point
+    vector<double> gSource,gSink; // conductance of each point to the terminals
+    vector<double> diag; // diagonal of Laplacian
+    vector<double> voltage[2]; // solution of each player (warm start for next solve)
+    vector<double> res,pre,dir,prod; // CG workspace
+    vector<double> flow; // current through each point in the last solve
+    void multiply(const vector<double>& v, vector<double>& out);
+public:
+    /**** constructors ****/
+    Circuit();
+    Circuit(int size);
+    /**** accessors ****/
+    int getIterations();
+    double getFlow(int n);
+    /**** algorithms ****/
+    double resistance(int id, const Bitboard& own, const Bitboard& opp);
+};
+
+/**** constructors ****/
+
+Circuit::Circuit():size(0),cells(0),iterations(0){}
+
+Circuit::Circuit(int size):nbor(6*size*size,-1),resist(size*size),conductance(6*size*size),gSource(size*size),gSink(size*size),
+diag(size*size),res(size*size),pre(size*size),dir(size*size),prod(size*size),flow(size*size){
+    // neighbor table and all workspace allocated once per board size
+    const point neighborVec[6] = {point(0,1),point(-1,1),point(-1,0),point(0,-1),point(1,-1),point(1,0)};
+    this->size = size;
+    this->cells = size*size;
+    this->iterations = 0;
+    voltage[0].assign(cells,0.5);
+    voltage[1].assign(cells,0.5);
+    for(int x=0; x<size; x++)
+        for(int y=0; y<size; y++)
+            for(int k=0; k<6; k++){
+                point q = point(x,y)+neighborVec[k];
+                if(q.x>=0 && q.x<size && q.y>=0 && q.y<size) nbor[6*(size*x+y)+k] = size*q.x+q.y;
+            }
+}
+
+/**** accessors ****/
+
+int Circuit::getIterations(){
+    // num of CG iterations of the last solve
+    return iterations;
+}
+
+double Circuit::getFlow(int n){
+    // current through graph node n in the last solve (move-ordering signal)
+    return flow[n];
+}
+
+/**** algorithms ****/
+
+void Circuit::multiply(const vector<double>& v, vector<double>& out){
+    // out = Laplacian*v (terminals held at fixed voltage, so excluded)
+    for(int i=0; i<cells; i++){
+        double s = diag[i]*v[i];
+        for(int k=0; k<6; k++){
+            int j = nbor[6*i+k];
+            if(j>=0) s -= conductance[6*i+k]*v[j];
+        }
+        out[i] = s;
+    }
+}
+
+double Circuit::resistance(int id, const Bitboard& own, const Bitboard& opp){
+    // edge-to-edge resistance of player id (own/opp: bitboards of player id and opponent)
+    // returns a large value (1e9) if the edges are cut off
+    STATS_COUNT(statCircuitSolves,1);
+    STATS_TIMER(phaseEvaluation);
+    const double blocked=1e9;
+    vector<double>& x = voltage[id-1];
+    for(int i=0; i<cells; i++){
+        point p(i/size,i%size);
+        resist[i] = opp.test(p)? -1 : own.test(p)? ownResistance : 1;
+    }
+
+    /**** assemble conductances (fixed sparsity, values only) ****/
+    for(int i=0; i<cells; i++){
+        diag[i] = gSource[i] = gSink[i] = 0;
+        if(resist[i]<0){
+            for(int k=0; k<6; k++) conductance[6*i+k] = 0;
+            continue;
+        }
+        for(int k=0; k<6; k++){
+            int j = nbor[6*i+k];
+            double g = (j<0 || resist[j]<0)? 0 : 1/(resist[i]+resist[j]);
+            conductance[6*i+k] = g;
+            diag[i] += g;
+        }
+        int start = (id==1)? i/size : i%size; // distance from source edge
+        if(start==0) gSource[i] = 1/resist[i];
+        if(start==size-1) gSink[i] = 1/resist[i];
+        diag[i] += gSource[i]+gSink[i];
+    }
+
+    /**** preconditioned conjugate gradient, warm started from last solution ****/
+    multiply(x,prod);
+    double bnorm = 0, rz = 0;
+    for(int i=0; i<cells; i++){
+        if(diag[i]==0) x[i] = 0;
+        res[i] = (diag[i]==0)? 0 : gSource[i]-prod[i]; // b = source current (source held at 1)
+        bnorm += gSource[i]*gSource[i];
+        pre[i] = (diag[i]==0)? 0 : res[i]/diag[i];
+        dir[i] = pre[i];
+        rz += res[i]*pre[i];
+    }
+    iterations = 0;
+    while(iterations<4*cells){
+        double rnorm = 0;
+        for(int i=0; i<cells; i++) rnorm += res[i]*res[i];
+        if(rnorm<=tolerance*tolerance*bnorm || rz==0) break;
+        multiply(dir,prod);
+        double dq = 0;
+        for(int i=0; i<cells; i++) dq += dir[i]*prod[i];
+        double alpha = rz/dq, rzNew = 0;
+        for(int i=0; i<cells; i++){
+            x[i] += alpha*dir[i];
+            res[i] -= alpha*prod[i];
+            pre[i] = (diag[i]==0)? 0 : res[i]/diag[i];
+            rzNew += res[i]*pre[i];
+        }
+        for(int i=0; i<cells; i++) dir[i] = pre[i]+rzNew/rz*dir[i];
+        rz = rzNew;
+        iterations++;
+    }
+
+    /**** current from source, and through each point ****/
+    double current = 0;
+    for(int i=0; i<cells; i++){
+        double f = gSource[i]*fabs(1-x[i])+gSink[i]*fabs(x[i]);
+        for(int k=0; k<6; k++){
+            int j = nbor[6*i+k];
+            if(j>=0) f += conductance[6*i+k]*fabs(x[i]-x[j]);
+        }
+        flow[i] = f/2;
+        current += gSource[i]*(1-x[i]);
+    }
+    if(current<1/blocked) return blocked;
+    return 1/current;
+}
+
+#endif
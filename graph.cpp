@@ -1,6 +1,7 @@
 #ifndef GRAPH
 #define GRAPH
-#include "util.cpp"
+#include "stats.cpp"
+#include <cstring>
 
 struct edge{
     // a tuple of int to represent graph edge
@@ -19,18 +20,42 @@ inline ostream& operator<<(ostream& out, const edge& e){
 class Graph{
 private:
     int size;
-    bool useList=false;
+    bool useList=false; // compressed sparse row storage instead of matrices
     double minCost,maxCost;
-    double** cost; // edge cost matrix
-    bool** graph; // graph edge matrix (aka. connectivity/adjacency matrix)
-    vector<int>* adjList; // adjacency list (for sparse graph)
+    // all storage lives in one block, shared between copies until one of them
+    // is modified (copy-on-write), so a copy is a pointer copy and a detach one memcpy
+    // the sharing test is not synchronized, so a graph and its copies must stay on one thread
+    shared_ptr<unsigned char[]> block; // raw storage block (doubles first, then ints, then bools)
+    int slots=0; // num of CSR slots in block
+    double* cost=0; // edge cost matrix, row-major (in block)
+    bool* graph=0; // graph edge matrix (aka. connectivity/adjacency matrix), row-major (in block)
+    // compressed sparse row (CSR) storage, for sparse graph
+    // neighbors of node n are in slots offsets[n] to offsets[n]+degree[n]-1,
+    // slots up to offsets[n+1]-1 are spare room for added edges
+    int* offsets=0; // first slot of each node (size+1 entries, in block)
+    int* degree=0; // num of neighbors of each node (in block)
+    int* nbors=0; // neighbor in each slot (in block)
+    double* weights=0; // edge cost in each slot (in block)
+    size_t blockBytes();
+    void allocate(bool sparse, int slots);
+    void bindBlock();
+    void detach();
+    int findSlot(int n, int m);
+    void insertSlot(int n, int m);
+    void removeSlot(int n, int m);
+    void reserveSlots(int n, int slots);
+    template <class F> void forEachNeighbor(int n, F f);
 public:
     /**** constructors ****/
     Graph();
     Graph(int size);
-    Graph(Graph& graph);
+    Graph(int size, bool sparse, int slots);
+    Graph(const Graph& g);
+    Graph(Graph&& g);
     Graph(int size, double density, double minCost, double maxCost);
     Graph(ifstream& file);
+    Graph& operator=(const Graph& g);
+    Graph& operator=(Graph&& g);
     /**** destructor ****/
     ~Graph();
     /**** accessors ****/
@@ -39,6 +64,7 @@ public:
     int getMinCost();
     int getMaxCost();
     bool getUseList();
+    bool isShared();
     void printGraph(bool matrix);
     bool isAdjacent(int n, int m);
     vector<int> getNeighbors(int n);
@@ -59,42 +85,145 @@ public:
     vector<edge> minSpanningTree(int n);
 };
 
+/**** helper functions ****/
+
+size_t Graph::blockBytes(){
+    // length of the storage block: matrices, or CSR arrays of slots
+    // (each array starts at a multiple of its alignment, as doubles come first)
+    if(useList) return slots*sizeof(double)+(2*size+1+slots)*sizeof(int);
+    return static_cast<size_t>(size)*size*(sizeof(double)+sizeof(bool));
+}
+
+void Graph::allocate(bool sparse, int slots){
+    // allocate a zeroed storage block: matrices, or CSR arrays with the given slots
+    STATS_COUNT(statAllocations,1);
+    useList = sparse;
+    this->slots = sparse? slots : 0;
+    block.reset(new unsigned char[blockBytes()]()); // aligned for any fundamental type
+    bindBlock();
+}
+
+void Graph::bindBlock(){
+    // point the storage arrays into block
+    unsigned char* base = block.get();
+    if(useList){
+        weights = reinterpret_cast<double*>(base);
+        offsets = reinterpret_cast<int*>(base+slots*sizeof(double));
+        degree = offsets+size+1;
+        nbors = degree+size;
+        cost = 0;
+        graph = 0;
+    }else{
+        cost = reinterpret_cast<double*>(base);
+        graph = reinterpret_cast<bool*>(base+static_cast<size_t>(size)*size*sizeof(double));
+        offsets = degree = nbors = 0;
+        weights = 0;
+    }
+}
+
+void Graph::detach(){
+    // take a private copy of a shared block before modifying it (one memcpy)
+    // (use_count is only exact while all sharing graphs are on the calling thread)
+    if(block && block.use_count()>1){
+        size_t bytes = blockBytes();
+        unsigned char* copy = new unsigned char[bytes];
+        memcpy(copy,block.get(),bytes);
+        block.reset(copy);
+        STATS_COUNT(statAllocations,1);
+        bindBlock();
+    }
+}
+
+int Graph::findSlot(int n, int m){
+    // CSR slot of neighbor m of node n (-1 if not adjacent)
+    for(int k=offsets[n]; k<offsets[n]+degree[n]; k++)
+        if(nbors[k]==m) return k;
+    return -1;
+}
+
+void Graph::insertSlot(int n, int m){
+    // add neighbor m to node n (cost 0), making room if node n has no spare slot
+    if(offsets[n]+degree[n]==offsets[n+1]) reserveSlots(n,max(2*degree[n],4));
+    int k = offsets[n]+degree[n]++;
+    nbors[k] = m;
+    weights[k] = 0;
+}
+
+void Graph::removeSlot(int n, int m){
+    // remove neighbor m of node n (last neighbor moved into its slot)
+    int k = findSlot(n,m);
+    if(k<0) return;
+    int last = offsets[n]+--degree[n];
+    nbors[k] = nbors[last];
+    weights[k] = weights[last];
+}
+
+void Graph::reserveSlots(int n, int slots){
+    // rebuild CSR block so that node n has room for slots neighbors
+    Graph old(*this); // keeps the old block alive while copying
+    int newSlots = 0;
+    for(int i=0; i<size; i++){
+        int room = old.offsets[i+1]-old.offsets[i];
+        newSlots += (i==n)? max(room,slots) : room;
+    }
+    allocate(true,newSlots);
+    offsets[0] = 0;
+    for(int i=0; i<size; i++){
+        int room = old.offsets[i+1]-old.offsets[i];
+        offsets[i+1] = offsets[i]+((i==n)? max(room,slots) : room);
+        degree[i] = old.degree[i];
+        for(int k=0; k<degree[i]; k++){
+            nbors[offsets[i]+k] = old.nbors[old.offsets[i]+k];
+            weights[offsets[i]+k] = old.weights[old.offsets[i]+k];
+        }
+    }
+}
+
+template <class F>
+inline void Graph::forEachNeighbor(int n, F f){
+    // call f(m,c) for each neighbor m of node n with edge cost c
+    if(useList){
+        for(int k=offsets[n]; k<offsets[n]+degree[n]; k++) f(nbors[k],weights[k]);
+    }else{
+        const bool* row = graph+static_cast<size_t>(n)*size;
+        for(int m=0; m<size; m++) if(row[m]) f(m,cost[static_cast<size_t>(n)*size+m]);
+    }
+}
+
 /**** constructors ****/
 
-Graph::Graph(){}
+Graph::Graph():size(0),minCost(1),maxCost(1){}
 
 Graph::Graph(int size){
     // construct empty graph
     this->size = size;
     this->minCost = 1;
     this->maxCost = 1;
-    graph = new bool*[size];
-    for(int i=0; i<size; i++)
-        graph[i] = new bool[size];
-    cost = new double*[size];
-    for(int i=0; i<size; i++)
-        cost[i] = new double[size];
+    allocate(false,0);
 }
 
-Graph::Graph(Graph& g){
-    // copy from graph g
-    this->size = g.getSize();
-    this->minCost = g.getMinCost();
-    this->maxCost = g.getMaxCost();
-    graph = new bool*[size];
-    for(int i=0; i<size; i++){
-        graph[i] = new bool[size];
-        for(int j=0; j<size; j++){
-            graph[i][j] = g.isAdjacent(i,j);
-        }
-    }
-    cost = new double*[size];
-    for(int i=0; i<size; i++){
-        cost[i] = new double[size];
-        for(int j=0; j<size; j++)
-            cost[i][j] = g.getCost(i,j);
-    }
-    if(g.getUseList()) makeAdjList();
+Graph::Graph(int size, bool sparse, int slots){
+    // construct empty graph, in CSR storage if sparse (slots: room reserved per node)
+    this->size = size;
+    this->minCost = 1;
+    this->maxCost = 1;
+    allocate(sparse,sparse? size*slots : 0);
+    if(sparse)
+        for(int i=0; i<=size; i++) offsets[i] = i*slots;
+}
+
+Graph::Graph(const Graph& g):size(g.size),useList(g.useList),minCost(g.minCost),maxCost(g.maxCost),block(g.block),slots(g.slots){
+    // copy from graph g (storage shared until either graph is modified)
+    if(block) bindBlock();
+}
+
+Graph::Graph(Graph&& g):size(g.size),useList(g.useList),minCost(g.minCost),maxCost(g.maxCost),block(move(g.block)),slots(g.slots){
+    // move from graph g (g is left empty)
+    if(block) bindBlock();
+    g.size = g.slots = 0;
+    g.cost = g.weights = 0;
+    g.graph = 0;
+    g.offsets = g.degree = g.nbors = 0;
 }
 
 Graph::Graph(int size, double density, double minCost, double maxCost){
@@ -102,23 +231,18 @@ Graph::Graph(int size, double density, double minCost, double maxCost){
     this->size = size;
     this->minCost = minCost;
     this->maxCost = maxCost;
+    allocate(false,0);
     /**** graph edge matrix ****/
-    graph = new bool*[size];
-    for(int i=0; i<size; i++)
-        graph[i] = new bool[size];
     // symmetric matrix
     for(int i=0; i<size; i++)
         for(int j=i; j<size; j++)
-            if(i==j) graph[i][j] = false; // no self-cycle
-            else graph[i][j] = graph[j][i] = (prob()<density);
+            if(i==j) graph[i*size+j] = false; // no self-cycle
+            else graph[i*size+j] = graph[j*size+i] = (prob()<density);
     /**** edge cost matrix ****/
-    cost = new double*[size];
-    for(int i=0; i<size; i++)
-        cost[i] = new double[size];
     // symmetric matrix
     for(int i=0; i<size; i++)
         for(int j=i; j<size; j++)
-            if(graph[i][j]) cost[i][j] = cost[j][i] = uniformRand(minCost,maxCost);
+            if(graph[i*size+j]) cost[i*size+j] = cost[j*size+i] = uniformRand(minCost,maxCost);
 }
 
 Graph::Graph(ifstream& file){
@@ -128,33 +252,46 @@ Graph::Graph(ifstream& file){
     double c;
     /**** read size from file ****/
     file >> size;
-    graph = new bool*[size];
-    for(int i=0; i<size; i++)
-        graph[i] = new bool[size];
-    cost = new double*[size];
-    for(int i=0; i<size; i++)
-        cost[i] = new double[size];
+    allocate(false,0);
     /**** read connections & costs from file ****/
     file >> i >> j >> c;
     minCost = maxCost = c;
     do{
-        graph[i][j] = 1; // graph edge matrix
-        cost[i][j] = c; // edge cost matrix
+        graph[i*size+j] = 1; // graph edge matrix
+        cost[i*size+j] = c; // edge cost matrix
         if(c<minCost) minCost = c;
         if(c>maxCost) maxCost = c;
     }while(file >> i >> j >> c);
 }
 
+Graph& Graph::operator=(const Graph& g){
+    // copy from graph g (storage shared until either graph is modified)
+    if(this==&g) return *this;
+    Graph tmp(g);
+    return *this = move(tmp);
+}
+
+Graph& Graph::operator=(Graph&& g){
+    // move from graph g (g is left empty)
+    if(this==&g) return *this;
+    size = g.size;
+    useList = g.useList;
+    minCost = g.minCost;
+    maxCost = g.maxCost;
+    slots = g.slots;
+    block = move(g.block);
+    if(block) bindBlock();
+    g.size = g.slots = 0;
+    g.cost = g.weights = 0;
+    g.graph = 0;
+    g.offsets = g.degree = g.nbors = 0;
+    return *this;
+}
+
 /**** destructor ****/
 
 Graph::~Graph(){
-    for(int i=0; i<size; i++){
-        delete[] graph[i];
-        delete[] cost[i];
-    }
-    delete[] graph;
-    delete[] cost;
-    if(useList) delete[] adjList;
+    // storage block is freed with the last graph sharing it
 }
 
 /**** accessors ****/
@@ -167,9 +304,13 @@ int Graph::getSize(){
 int Graph::getEdges(){
     // number of edges
     int edges = 0;
+    if(useList){
+        for(int i=0; i<size; i++) edges += degree[i];
+        return edges/2;
+    }
     for(int i=0; i<size; i++)
         for(int j=i+1; j<size; j++)
-            edges += graph[i][j];
+            edges += graph[i*size+j];
     return edges;
 }
 
@@ -184,17 +325,22 @@ int Graph::getMaxCost(){
 }
 
 bool Graph::getUseList(){
-    // bool of adjacency list or not
+    // bool of CSR storage (adjacency list) or not
     return useList;
 }
 
+bool Graph::isShared(){
+    // check if storage is still shared with a copy
+    return block && block.use_count()>1;
+}
+
 void Graph::printGraph(bool matrix=true){
     if(matrix){
         // print adjacency matrix
         seperator(2*size-1);
         for(int i=0; i<size; i++){
             for(int j=0; j<size; j++)
-                cout << graph[i][j] << ' ';
+                cout << isAdjacent(i,j) << ' ';
             cout << endl;
         }
         seperator(2*size-1);
@@ -203,8 +349,7 @@ void Graph::printGraph(bool matrix=true){
         seperator(2*size-1);
         for(int i=0; i<size; i++){
             cout << i << ": ";
-            for(int j=0; j<size; j++)
-                if(graph[i][j]==1) cout << j << ' ';
+            for(auto j:getNeighbors(i)) cout << j << ' ';
             cout << endl;
         }
         seperator(2*size-1);
@@ -213,20 +358,24 @@ void Graph::printGraph(bool matrix=true){
 
 bool Graph::isAdjacent(int n, int m){
     // check if node n and m are connected
-    return graph[n][m];
+    if(useList) return findSlot(n,m)>=0;
+    return graph[n*size+m];
 }
 
 vector<int> Graph::getNeighbors(int n){
     // neighbors of node n
     vector<int> nbors;
-    for(int i=0; i<size; i++)
-        if(graph[n][i]==1) nbors.push_back(i);
+    forEachNeighbor(n,[&](int m, double){nbors.push_back(m);});
     return nbors;
 }
 
 double Graph::getCost(int n, int m){
     // cost from node n to m
-    return cost[n][m];
+    if(useList){
+        int k = findSlot(n,m);
+        return (k<0)? 0 : weights[k];
+    }
+    return cost[n*size+m];
 }
 
 void Graph::printShortestPaths(int n){
@@ -259,7 +408,7 @@ void Graph::printMinSpanningTree(int n){
     vector<edge> mst = minSpanningTree(0);
     double treeCost = 0;
     for(int i=0; i<mst.size(); i++)
-        treeCost += cost[mst[i].node1][mst[i].node2];
+        treeCost += getCost(mst[i].node1,mst[i].node2);
     cout << "minimum spanning tree:" << endl;
     cout << mst << endl;
     cout << "tree cost: " << treeCost << endl;
@@ -268,75 +417,97 @@ void Graph::printMinSpanningTree(int n){
 /**** mutators ****/
 
 void Graph::makeAdjList(){
-    // fill in adjacency list
-    adjList = new vector<int>[size];
-    for(int i=0; i<size; i++)
+    // convert matrices to CSR storage (adjacency list), freeing the matrices
+    if(useList) return;
+    Graph old(*this); // keeps the matrices alive while copying
+    int edges = 0;
+    for(int i=0; i<size*size; i++) edges += old.graph[i];
+    allocate(true,edges);
+    offsets[0] = 0;
+    for(int i=0; i<size; i++){
+        int k = offsets[i];
         for(int j=0; j<size; j++)
-            if(graph[i][j]) adjList[i].push_back(j);
-    useList = true;
+            if(old.graph[i*size+j]){
+                nbors[k] = j;
+                weights[k++] = old.cost[i*size+j];
+            }
+        degree[i] = k-offsets[i];
+        offsets[i+1] = k;
+    }
 }
 
 void Graph::addEdge(int n, int m){
     // connect node n and m
-    graph[n][m] = graph[m][n] = 1;
+    detach();
     if(useList){
-        adjList[n].push_back(m);
-        adjList[m].push_back(n);
+        if(findSlot(n,m)>=0) return;
+        insertSlot(n,m);
+        insertSlot(m,n);
+        return;
     }
+    graph[n*size+m] = graph[m*size+n] = 1;
 }
 
 void Graph::deleteEdge(int n, int m){
     // disconnect node n and m
-    graph[n][m] = graph[m][n] = 0;
-    cost[n][m] = cost[m][n] = 0;
+    detach();
     if(useList){
-        adjList[n].erase(find(adjList[n].begin(),adjList[n].end(),m));
-        adjList[m].erase(find(adjList[m].begin(),adjList[m].end(),n));
+        removeSlot(n,m);
+        removeSlot(m,n);
+        return;
     }
+    graph[n*size+m] = graph[m*size+n] = 0;
+    cost[n*size+m] = cost[m*size+n] = 0;
 }
 
 void Graph::setCost(int n, int m, double c){
     // set cost from node n to m as c
-    cost[n][m] = cost[m][n] = c;
+    detach();
+    if(useList){
+        int k = findSlot(n,m);
+        if(k>=0) weights[k] = c;
+        k = findSlot(m,n);
+        if(k>=0) weights[k] = c;
+        return;
+    }
+    cost[n*size+m] = cost[m*size+n] = c;
 }
 
 void Graph::setRandCost(int n, int m){
     // randomly set cost from node n to m
-    cost[n][m] = cost[m][n] = uniformRand(minCost,maxCost);
+    setCost(n,m,uniformRand(minCost,maxCost));
 }
 
 /**** algorithms ****/
 
 bool Graph::isConnected(){
-    // check if graph is connected
-    int oldSize, closedSize=0;
-    bool* closed = new bool[size]; // expanded nodes
-    bool* open = new bool[size]; // nodes to be expanded
-    for(int i=0; i<size; i++)
-        closed[i] = open[i] = false;
-    open[0] = true; // initialization: start from node 0
-    while(closedSize<size){
-        oldSize = closedSize;
-        for(int i=0; i<size; i++){
-            if(open[i] && !closed[i]){ // new nodes to expand
-                closed[i] = true;
+    // check if graph is connected (depth first search from node 0)
+    STATS_COUNT(statGraphSearches,1);
+    STATS_TIMER(phaseGraphSearch);
+    if(size==0) return true;
+    int closedSize = 1;
+    vector<bool> closed(size,false); // reached nodes
+    vector<int> open(1,0); // nodes to be expanded
+    closed[0] = true; // initialization: start from node 0
+    while(!open.empty()){
+        int current = open.back();
+        open.pop_back();
+        forEachNeighbor(current,[&](int m, double){
+            if(!closed[m]){ // new nodes to expand
+                closed[m] = true;
                 closedSize++;
-                for(int j=0; j<size; j++)
-                    open[j] = open[j]||graph[i][j];
+                open.push_back(m);
             }
-            // for(int i=0; i<size; i++) cout << closed[i] << ' ';
-            // cout << "\n";
-            // for(int i=0; i<size; i++) cout << open[i] << ' ';
-            // cout << "\n\n";
-        }
-        if(oldSize==closedSize) return false;
+        });
     }
-    return true;
+    return closedSize==size;
 }
 
 int* Graph::shortestPathNodes(int n){
     // Dijkstra's shortest path from source node n to other nodes
     // return an array of (prev) node indices
+    STATS_COUNT(statGraphSearches,1);
+    STATS_TIMER(phaseGraphSearch);
     const int inf = size*maxCost;
     int current; // node currently being explored
     int* prev = new int[size];
@@ -344,6 +515,7 @@ int* Graph::shortestPathNodes(int n){
     double* nodeCost = new double[size]; // tentative cost from node n
     double c; // tentative cost
     priorityQueue q; // priority queue for uniform cost search
+    q.reserve(size);
 
     /**** initialization ****/
     nodeCost[n] = 0; // start from node n
@@ -360,40 +532,31 @@ int* Graph::shortestPathNodes(int n){
     // loop until queue is empty or remaining nodes are disconnected
     while(!q.isEmpty() && q.peekHeadNode().value!=-inf){
         current = q.popHeadNode().label; // pop node with lowest cost
-        if(useList){
+        forEachNeighbor(current,[&](int i, double w){
             // unvisited neighbors of current node
-            for(auto i:adjList[current])
-                if(!closed[i]){
-                    c = nodeCost[current]+cost[current][i];
-                    // update tentative cost
-                    if(c<nodeCost[i]){
-                        nodeCost[i] = c;
-                        prev[i] = current;
-                        q.chgPriority(i,-c); // update priority queue
-                    }
-                }
-        }else{
-            for(int i=0; i<size; i++)
-                // unvisited neighbors of current node
-                if(!closed[i] && graph[current][i]){
-                    c = nodeCost[current]+cost[current][i];
-                    // update tentative cost
-                    if(c<nodeCost[i]){
-                        nodeCost[i] = c;
-                        prev[i] = current;
-                        q.chgPriority(i,-c); // update priority queue
-                    }
+            if(!closed[i]){
+                c = nodeCost[current]+w;
+                // update tentative cost
+                if(c<nodeCost[i]){
+                    nodeCost[i] = c;
+                    prev[i] = current;
+                    q.chgPriority(i,-c); // update priority queue
                 }
-        }
+            }
+        });
         closed[current] = true;
     }
 
+    delete[] closed;
+    delete[] nodeCost;
     return prev;
 }
 
 vector<node>* Graph::shortestPaths(int n){
     // Dijkstra's shortest path from source node n to other nodes
     // return an array of shortest path vectors (of nodes)
+    STATS_COUNT(statGraphSearches,1);
+    STATS_TIMER(phaseGraphSearch);
     const int inf = size*maxCost;
     vector<node>* paths = new vector<node>[size]; // shortest paths
     int current; // node currently being explored
@@ -402,6 +565,7 @@ vector<node>* Graph::shortestPaths(int n){
     double* nodeCost = new double[size]; // tentative cost from node n
     double c; // tentative cost
     priorityQueue q; // priority queue for uniform cost search
+    q.reserve(size);
 
     /**** initialization ****/
     nodeCost[n] = 0; // start from node n
@@ -419,31 +583,18 @@ vector<node>* Graph::shortestPaths(int n){
     // loop until queue is empty or remaining nodes are disconnected
     while(!q.isEmpty() && q.peekHeadNode().value!=-inf){
         current = q.popHeadNode().label; // pop node with lowest cost
-        if(useList){
+        forEachNeighbor(current,[&](int i, double w){
             // unvisited neighbors of current node
-            for(auto i:adjList[current])
-                if(!closed[i]){
-                    c = nodeCost[current]+cost[current][i];
-                    // update tentative cost
-                    if(c<nodeCost[i]){
-                        nodeCost[i] = c;
-                        prev[i] = current;
-                        q.chgPriority(i,-c); // update priority queue
-                    }
-                }
-        }else{
-            for(int i=0; i<size; i++)
-                // unvisited neighbors of current node
-                if(!closed[i] && graph[current][i]){
-                    c = nodeCost[current]+cost[current][i];
-                    // update tentative cost
-                    if(c<nodeCost[i]){
-                        nodeCost[i] = c;
-                        prev[i] = current;
-                        q.chgPriority(i,-c); // update priority queue
-                    }
+            if(!closed[i]){
+                c = nodeCost[current]+w;
+                // update tentative cost
+                if(c<nodeCost[i]){
+                    nodeCost[i] = c;
+                    prev[i] = current;
+                    q.chgPriority(i,-c); // update priority queue
                 }
-        }
+            }
+        });
         closed[current] = true;
         // q.print(); // show the search
     }
@@ -455,7 +606,6 @@ vector<node>* Graph::shortestPaths(int n){
     for(int m=0; m<size; m++){
         if(prev[m]!=-1){ // node m connected to n
             int i = m; // iterator from node m to n
-            int prev_i = m;
             while(i!=n){ // continue if have not traced back to node n
                 paths[m].insert(paths[m].begin(),node(i,nodeCost[i]));
                 i = prev[i];
@@ -463,18 +613,24 @@ vector<node>* Graph::shortestPaths(int n){
             paths[m].insert(paths[m].begin(),node(n,0)); // prepend source node n
         }
     }
+    delete[] prev;
+    delete[] closed;
+    delete[] nodeCost;
     return paths;
 }
 
 vector<edge> Graph::minSpanningTree(int n){
     // Prim's minimum spanning tree for a connected graph
     // return a vector of edges
+    STATS_COUNT(statGraphSearches,1);
+    STATS_TIMER(phaseGraphSearch);
     const int inf = size*maxCost;
     vector<edge> mst; // minimum spanning tree
     int current; // node currently being explored
     int* prev = new int[size];
     double* nodeCost = new double[size]; // tentative cheapest edge cost
     priorityQueue q; // priority queue for uniform cost search
+    q.reserve(size);
 
     /**** initialization ****/
     nodeCost[n] = 0; // start from node n
@@ -491,19 +647,22 @@ vector<edge> Graph::minSpanningTree(int n){
     // loop until queue is empty
     while(!q.isEmpty()){
         current = q.popHeadNode().label; // pop node with lowest cost
-        for(int i=0; i<size; i++)
-            if(graph[current][i]) // neighbors of current node
-                if(q.contains(i) && cost[current][i]<nodeCost[i]){
-                    nodeCost[i] = cost[current][i];
-                    prev[i] = current;
-                    q.chgPriority(i,-cost[current][i]);
-                }
+        forEachNeighbor(current,[&](int i, double w){
+            // neighbors of current node
+            if(q.contains(i) && w<nodeCost[i]){
+                nodeCost[i] = w;
+                prev[i] = current;
+                q.chgPriority(i,-w);
+            }
+        });
         // q.print(); // show the search
     }
 
     /**** collect edges into mst ****/
     for(int i=0; i<size; i++)
         if(i!=n) mst.push_back(edge(prev[i],i));
+    delete[] prev;
+    delete[] nodeCost;
     return mst;
 }
 
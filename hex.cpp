@@ -1,20 +1,87 @@
 #ifndef HEX
 #define HEX
 #include "graph.cpp"
+#include "bitboard.cpp"
+#include "parallel.cpp"
+#include "mcts.cpp"
+#include "playout.cpp"
+#include "search.cpp"
+#include "circuit.cpp"
+#include "book.cpp"
+#include "hsearch.cpp"
+#include "inferior.cpp"
+#include "record.cpp"
+#include <unordered_set>
+#include <map>
+#include <tuple>
+
+const string strategyNames[] = {"","random","rightmost","Monte Carlo","MCTS","alpha-beta","Monte Carlo (AMAF)"}; // names of machine strategies
+const int strategyCount = sizeof(strategyNames)/sizeof(strategyNames[0])-1; // num of machine strategies (numbered from 1)
+
+struct moveRecord{
+    // entry of the undo stack
+    int id; // player who moved
+    point p; // board point played
+    int setsMark; // checkpoint of player's disjoint set before the move
+    int emptyPos; // position of p in the empty cell index before the move
+    moveRecord(int id, const point& p, int setsMark, int emptyPos):id(id),p(p),setsMark(setsMark),emptyPos(emptyPos){}
+};
 
 class Hex{
 private:
     int size; // dimension of board
-    int mode; // game mode: 1. human vs human, 2. human vs machine (initialized at 0)
+    int mode; // game mode: 1. human vs human, 2. human vs machine, 3. machine vs machine (initialized at 0)
     int round; // current playing round (initialized at 0)
     int player; // player at current round, takes 1 or 2 (initialized at 0)
     int winner; // winner at final round, takes 1 or 2
-    int* marker; // array of players occupying the nodes
-    Graph player1Graph; // graph representation of player 1's moves
-    Graph player2Graph; // graph representation of player 2's moves
+    int strategy[3]; // machine strategy of player 1 and 2: 1. random, 2. rightmost, 3. MC, 4. MCTS, 5. alpha-beta, 6. MC with AMAF (initialized at 0)
+    int moveTime; // time limit of machine search per move in ms (initialized at 1000)
+    int gameTime; // time budget of machine search per player per game in ms, 0 if unlimited (initialized at 0)
+    double timeUsed[3]; // time used by machine search of player 1 and 2 in ms
+    int threads; // number of workers for machine search (initialized at 1)
+    bool quiet; // no progress output during machine search (initialized at false)
+    uint64_t seed; // seed of machine search random streams (initialized at 0)
+    long long playouts; // num of playouts run for the last machine move
+    double moveProb; // estimated win prob of the last machine move, -1 if the strategy gives none
+    long long nodes; // num of search nodes for the last machine move
+    double moveSeconds[3]; // total time of machine moves of player 1 and 2
+    int moveCount[3]; // num of machine moves of player 1 and 2
+    Bitboard player1Stones; // bitboard of player 1's stones (canonical board state)
+    Bitboard player2Stones; // bitboard of player 2's stones (canonical board state)
+    Bitboard northEdge,southEdge,westEdge,eastEdge; // bitboards of board edges
+    disjointSet player1Sets; // connectivity of player 1's stones (with virtual border nodes)
+    disjointSet player2Sets; // connectivity of player 2's stones (with virtual border nodes)
+    int north,south,west,east; // virtual border nodes (N-S for player 1, W-E for player 2)
     vector<point> player1; // player 1's moves (marker X, goal N-S)
     vector<point> player2; // player 2's moves (marker O, goal E-W)
-    vector<point> boardPoints; // all points in board
+    vector<point> boardPoints; // all points in board (row-major, i.e., indexed by graph node)
+    vector<int> emptyCells; // graph nodes of unoccupied points (swap-remove on play, exact restore on undo)
+    vector<int> emptyIndex; // position of each graph node in emptyCells
+    vector<int8_t> owner; // player occupying each graph node (0 if unoccupied)
+    vector<int> neighbors; // graph nodes around each graph node, 6 per node in order of neighborVec (-1 off board)
+    vector<int> history; // graph nodes of all moves, in order of play
+    vector<moveRecord> undoStack; // moves that can be taken back, in order of play
+    mctsTree tree; // search tree of MCTS, kept across rounds
+    int treeStones; // num of moves played at the position of the tree root
+    uint64_t treeKey; // key of the position of the tree root (stones and player to move)
+    zobristKeys zobrist; // Zobrist keys of board points
+    uint64_t hashKey; // Zobrist hash of current position
+    transpositionTable table; // transposition table of alpha-beta search
+    bool aborted; // alpha-beta search ran out of time
+    high_resolution_clock::time_point deadline; // end of current machine search
+    vector<vector<point>> plyMoves; // move buffer of each search ply
+    vector<vector<double>> plyScores; // move-ordering score of each point at each search ply (allocated when reached)
+    int solverCells; // num of empty cells from which machine search solves the position exactly, 0 if never (initialized at 25)
+    pnTable proofTable; // transposition table of proof-number search
+    vector<vector<point>> solveMoves; // move buffer of each proof-number search ply
+    vector<vector<uint64_t>> solveKeys; // key of each child position at each proof-number search ply
+    HSearch hsearch; // virtual connections of both players
+    InferiorCells inferior; // dead, captured and dominated cells of the position searched
+    Circuit circuit; // resistance circuit of getHeuristic
+    statsBlock stats; // instrumentation of machine search (counted with -DHEX_STATS)
+    unique_ptr<workerPool> pool; // workers of Monte Carlo search (started by the first search, kept across moves)
+    shared_ptr<openingBook> book; // opening book of machine search (shared by tournament games, 0 if none)
+    shared_ptr<recordWriter> recorder; // record file of finished games (shared by tournament games, 0 if none)
     const vector<point> neighborVec{point(0,1),point(-1,1),point(-1,0),point(0,-1),point(1,-1),point(1,0)}; // vectors pointing to (potential) neighbors
 public:
     /**** constructors ****/
@@ -26,27 +93,64 @@ public:
     int toNode(const point& p);
     point toPoint(int n);
     bool inBoard(const point& p);
+    void emptyPoints(vector<point>& points);
     /**** accessors ****/
-    void printBoard(int* Marker);
+    void setThreads(int threads);
+    void setSeed(uint64_t seed);
+    void setStrategy(int id, int strategy);
+    void setMoveTime(int moveTime);
+    void setGameTime(int gameTime);
+    void setQuiet(bool quiet);
+    void setSolverCells(int cells);
+    bool setPosition(const string& board);
+    bool loadBook(const string& path);
+    bool openRecords(const string& path);
+    void setPlayer(int id);
+    int occupant(const point& p);
+    void printBoard();
     /**** game ****/
     void welcome();
     void result();
     void chooseMode();
+    void chooseStrategy(int id);
     void chooseFirstPlayer();
     void nextPlayer();
     vector<point> legalMoves();
-    bool hasWon(const vector<point>& start, const vector<point>& end, Graph& playerGraph);
+    bool hasWon(int id, disjointSet& playerSets);
+    bool hasWon(int id, const Bitboard& stones, Bitboard& reach);
     bool gameFinished();
     void inputNextMove();
-    void logInputtedMove(vector<point>& Player, Graph& playerGraph, const point& p);
+    void logInputtedMove(int id, const point& p);
+    void play(int id, const point& p);
+    void undo();
+    int allocateTime();
+    bool timeUp();
     point machineMove(const vector<point>& moves);
     // MACHINE ALGORITHMS HERE!
     point machineRandomMove(const vector<point>& moves);
     point machineRightmostMove(const vector<point>& moves);
     point machineMCMove(const vector<point>& moves);
-    point machineAlphaBetaMove(const vector<point>& moves); // TO DO
-    int getHeuristic();
+    point machineMCTSMove(const vector<point>& moves);
+    point machineAlphaBetaMove(const vector<point>& moves);
+    int alphaBeta(int id, int depth, int ply, int alpha, int beta);
+    uint64_t solveKey(uint64_t key, int id);
+    bool winsAt(int id, const point& p);
+    int mustPlay(int id, vector<point>& moves);
+    int solve(int id, point& move);
+    void dfpn(int id, int ply, uint32_t thPhi, uint32_t thDelta);
+    int solvePosition(point& move);
+    void runSolver();
+    int getHeuristic(int id);
+    void writeStats();
+    uint64_t rotatedKey();
+    void buildBook(const string& path, int plies);
+    void bookLines(int plies, vector<bookEntry>& entries, unordered_set<uint64_t>& done);
     void runGame();
+    int runMachineGame();
+    void runTournament(int games);
+    void evaluatePositions(istream& in, ostream& out);
+    void recordGame();
+    static void reportRecords(const string& path);
 };
 
 /**** helper functions ****/
@@ -59,38 +163,155 @@ inline bool Hex::inBoard(const point& p){
     return false;
 }
 
+void Hex::emptyPoints(vector<point>& points){
+    // fill points with unoccupied board points (reusing its storage), in order of the empty cell index
+    points.clear();
+    for(auto n:emptyCells) points.push_back(boardPoints[n]);
+}
+
 /**** constructors ****/
 
 Hex::Hex(){}
 
-Hex::Hex(int size):player1Graph(size*size),player2Graph(size*size){
+Hex::Hex(int size):player1Stones(size),player2Stones(size),northEdge(size),southEdge(size),westEdge(size),eastEdge(size),
+player1Sets(size*size+4),player2Sets(size*size+4),zobrist(size*size),hsearch(size),inferior(size),circuit(size){
     // construct Hex class
     this->size = size;
     this->mode = 0;
     this->round = 0;
     this->player = 0;
-    // this->player1Graph = Graph(size*size);
-    // this->player2Graph = Graph(size*size);
-    // use adjacency list for sparse graphs
-    // player1Graph.makeAdjList();
-    // player2Graph.makeAdjList();
-    point p;
-    marker = new int[size*size];
+    this->strategy[0] = this->strategy[1] = this->strategy[2] = 0;
+    this->moveSeconds[0] = this->moveSeconds[1] = this->moveSeconds[2] = 0;
+    this->moveCount[0] = this->moveCount[1] = this->moveCount[2] = 0;
+    this->moveTime = 1000;
+    this->gameTime = 0;
+    this->timeUsed[0] = this->timeUsed[1] = this->timeUsed[2] = 0;
+    this->hashKey = 0;
+    this->nodes = 0;
+    this->treeStones = 0;
+    this->treeKey = 0;
+    this->threads = 1;
+    this->quiet = false;
+    this->seed = 0;
+    this->playouts = 0;
+    this->moveProb = -1;
+    this->solverCells = 25;
+    // virtual border nodes follow the board nodes
+    north = size*size;
+    south = size*size+1;
+    west = size*size+2;
+    east = size*size+3;
+    // board edges
+    northEdge.fillRow(0);
+    southEdge.fillRow(size-1);
+    westEdge.fillColumn(0);
+    eastEdge.fillColumn(size-1);
     // fill in board points
     for(int i=0; i<size; i++)
         for(int j=0; j<size; j++)
             boardPoints.push_back(point(i,j));
+    // empty cell index and neighbor table
+    emptyCells.resize(size*size);
+    emptyIndex.resize(size*size);
+    owner.assign(size*size,0);
+    neighbors.assign(6*size*size,-1);
+    for(auto p:boardPoints){
+        int n = toNode(p);
+        emptyCells[n] = emptyIndex[n] = n;
+        for(int k=0; k<6; k++)
+            if(inBoard(p+neighborVec[k])) neighbors[6*n+k] = toNode(p+neighborVec[k]);
+    }
+    // reserve move lists, so that play/undo never allocate
+    player1.reserve(size*size);
+    player2.reserve(size*size);
+    history.reserve(size*size);
+    undoStack.reserve(size*size);
 }
 
 /**** destructors ****/
 
-Hex::~Hex(){
-    delete[] marker;
-}
+Hex::~Hex(){}
 
 /**** accessors ****/
 
-void Hex::printBoard(int* Marker){
+void Hex::setThreads(int threads){
+    // set number of workers for machine search
+    this->threads = max(threads,1);
+}
+
+void Hex::setSeed(uint64_t seed){
+    // set seed of machine search (same seed and threads reproduce the same moves)
+    this->seed = seed;
+}
+
+void Hex::setStrategy(int id, int strategy){
+    // set machine strategy of player id
+    this->strategy[id] = strategy;
+}
+
+void Hex::setMoveTime(int moveTime){
+    // set time limit of machine search per move (ms)
+    this->moveTime = moveTime;
+}
+
+void Hex::setGameTime(int gameTime){
+    // set time budget of machine search per player for the whole game (ms, 0 if unlimited)
+    this->gameTime = gameTime;
+}
+
+bool Hex::openRecords(const string& path){
+    // append finished games to the record file of path (returns false if it cannot be written)
+    recorder = make_shared<recordWriter>();
+    if(recorder->open(path)) return true;
+    recorder.reset();
+    return false;
+}
+
+bool Hex::loadBook(const string& path){
+    // map opening book of path for machine search (returns false if missing or for another board size)
+    book = make_shared<openingBook>();
+    if(book->open(path,size)) return true;
+    book.reset();
+    return false;
+}
+
+void Hex::setSolverCells(int cells){
+    // set num of empty cells from which machine search solves the position exactly (0: never)
+    this->solverCells = cells;
+}
+
+bool Hex::setPosition(const string& board){
+    // set up a position from a row-major string of size*size cells:
+    // X (player 1), O (player 2) or . (empty), other characters ignored
+    // player to move: the one with fewer stones (player 1 if equal)
+    int n = 0;
+    for(auto c:board){
+        if(c!='X' && c!='O' && c!='.') continue;
+        if(n==size*size) return false;
+        if(c!='.') play((c=='X')? 1 : 2,toPoint(n));
+        n++;
+    }
+    player = (player2.size()<player1.size())? 2 : 1;
+    round = history.size();
+    return n==size*size;
+}
+
+void Hex::setQuiet(bool quiet){
+    // set if progress output of machine search is suppressed
+    this->quiet = quiet;
+}
+
+void Hex::setPlayer(int id){
+    // set player to move (1 or 2)
+    this->player = id;
+}
+
+int Hex::occupant(const point& p){
+    // player occupying point p (0 if unoccupied)
+    return owner[toNode(p)];
+}
+
+void Hex::printBoard(){
     // print game board
     // marker: player1 = X, player2 = O
     point p;
@@ -102,14 +323,14 @@ void Hex::printBoard(int* Marker){
         cout << string(2*i,' ');
         for(int j=0; j<size-1; j++){
             p = point(i,j);
-            if(Marker[toNode(p)]==1) cout << "X - "; // occupied by player 1
-            else if(Marker[toNode(p)]==2) cout << "O - "; // occupied by player 2
+            if(occupant(p)==1) cout << "X - "; // occupied by player 1
+            else if(occupant(p)==2) cout << "O - "; // occupied by player 2
             else cout << ". - "; // unoccupied
         }
         // last board points
         p = point(i,size-1);
-        if(Marker[toNode(p)]==1) cout << "X" << endl; // occupied by player 1
-        else if(Marker[toNode(p)]==2) cout << "O" << endl; // occupied by player 2
+        if(occupant(p)==1) cout << "X" << endl; // occupied by player 1
+        else if(occupant(p)==2) cout << "O" << endl; // occupied by player 2
         else cout << "." << endl; // unoccupied
         /* print connections between board points (edges) */
         if(i<size-1){
@@ -152,19 +373,35 @@ void Hex::result(){
 }
 
 void Hex::chooseMode(){
-    // choose game mode: 1. human vs human, or 2. human vs machine
-    // ADD: MODE 3 - MACHINE VS MACHINE?
+    // choose game mode: 1. human vs human, 2. human vs machine, or 3. machine vs machine
     cout <<
     "Game mode:\n"
     "  1. human vs human\n"
-    "  2. human vs machine" << endl;
-    while(mode!=1 && mode!=2){
-        cout << "Please choose a mode (1 or 2): ";
+    "  2. human vs machine\n"
+    "  3. machine vs machine (tournament)" << endl;
+    while(mode<1 || mode>3){
+        cout << "Please choose a mode (1-3): ";
         cin >> mode;
     }
     if(mode==2) cout << "  You are player 1, machine is player 2." << endl;
 }
 
+void Hex::chooseStrategy(int id){
+    // choose machine strategy of player id (mode 2 and 3)
+    cout <<
+    "Machine strategy:\n"
+    "  1. random move\n"
+    "  2. rightmost move\n"
+    "  3. Monte Carlo\n"
+    "  4. Monte Carlo tree search (UCT)\n"
+    "  5. alpha-beta minimax\n"
+    "  6. Monte Carlo with all-moves-as-first statistics" << endl;
+    while(strategy[id]<1 || strategy[id]>6){
+        cout << "Please choose a strategy for player " << id << " (1-6): ";
+        cin >> strategy[id];
+    }
+}
+
 void Hex::chooseFirstPlayer(){
     // choose first player (who makes a move at round 1)
     while(player!=1 && player!=2){
@@ -181,50 +418,30 @@ void Hex::nextPlayer(){
 vector<point> Hex::legalMoves(){
     // return a vector of legal moves for current player (any unoccupied spaces on board)
     vector<point> moves;
-    for(auto p:boardPoints)
-        // is a legal move if p is not any of the players' previous moves, i.e., unoccupied
-        if(find(player1.begin(),player1.end(),p)==player1.end() &&
-        find(player2.begin(),player2.end(),p)==player2.end())
-            moves.push_back(p);
+    emptyPoints(moves);
     return moves;
 }
 
-bool Hex::hasWon(const vector<point>& start, const vector<point>& end, Graph& playerGraph){
-    // check if there is a path linking to opposite edge
-    // i.e., any paths that go from start points to end points
-    // CORRECTION: inefficient! could make borders on one side and the opposite, then do one search
-    int* pathNodes;
-    if(start.size()==0 || end.size()==0) return false;
-    for(auto p:start){
-        pathNodes = playerGraph.shortestPathNodes(toNode(p));
-        for(auto q:end)
-            if(pathNodes[toNode(q)]!=-1)
-                return true;
-    }
-    return false;
+bool Hex::hasWon(int id, disjointSet& playerSets){
+    // check if player id links to opposite edge
+    // i.e., the two virtual border nodes are in the same set
+    if(id==1) return playerSets.isConnected(north,south);
+    return playerSets.isConnected(west,east);
+}
+
+bool Hex::hasWon(int id, const Bitboard& stones, Bitboard& reach){
+    // check if player id's stones link to opposite edge, by flood fill from one edge
+    if(id==1) return stones.connects(northEdge,southEdge,reach);
+    return stones.connects(westEdge,eastEdge,reach);
 }
 
 bool Hex::gameFinished(){
     // check if game has finished, i.e., one player has won
-    vector<point> start,end;
-
-    /* has player 1 won? */
-    for(auto p:player1){
-        if(p.x==0) start.push_back(p); // board points on top edge (North)
-        if(p.x==size-1) end.push_back(p); // board points on bottom edge (South)
-    }
-    if(hasWon(start,end,player1Graph)){
+    if(hasWon(1,player1Sets)){
         winner = 1;
         return true;
     }
-
-    /* has player 2 won? */
-    start.clear(); end.clear();
-    for(auto p:player2){
-        if(p.y==0) start.push_back(p); // board points on left edge (West)
-        if(p.y==size-1) end.push_back(p); // board points on right edge (East)
-    }
-    if(hasWon(start,end,player2Graph)){
+    if(hasWon(2,player2Sets)){
         winner = 2;
         return true;
     }
@@ -252,125 +469,1045 @@ void Hex::inputNextMove(){
             i = stoi(inputi);
             j = stoi(inputj);
             p = point(i,j);
-            if(find(moves.begin(),moves.end(),p)!=moves.end()) isIllegal = false; // a legal move
+            if(inBoard(p) && occupant(p)==0) isIllegal = false; // a legal move
             else cout << "(previous move illegal) "; // an illegal move
         }
     }else
     /* call for machine input */
     if(mode==2 && player==2){
         auto startTime = high_resolution_clock::now();
+        playouts = nodes = 0;
         p = machineMove(moves);
         auto endTime = high_resolution_clock::now();
+        double elapsed = duration<double>(endTime-startTime).count();
+        moveSeconds[player] += elapsed; // for the game record, as in runMachineGame
+        moveCount[player]++;
         cout << "(machine move) round " << round << " | now player 2's turn: " << p << endl;
-        cout << "               time taken: " << duration_cast<seconds>(endTime-startTime).count()  << " s" << endl;
+        cout << "               time taken: " << elapsed << " s" << endl;
+        if(playouts>0) cout << "               playouts/s: " << static_cast<long long>(playouts/elapsed) << endl;
+        if(nodes>0) cout << "               nodes/s: " << static_cast<long long>(nodes/elapsed)
+        << " | TT hit rate: " << table.getHitRate() << endl;
     }
 
     /* log inputted move */
-    if(player==1){
-        marker[toNode(p)] = 1;
-        logInputtedMove(player1,player1Graph,p);
-    }else if(player==2){
-        marker[toNode(p)] = 2;
-        logInputtedMove(player2,player2Graph,p);
-    }
+    logInputtedMove(player,p);
 }
 
-void Hex::logInputtedMove(vector<point>& Player, Graph& playerGraph, const point& p){
-    // log inputted move
+void Hex::logInputtedMove(int id, const point& p){
+    // log inputted move of player id
+    play(id,p);
+}
+
+void Hex::play(int id, const point& p){
+    // place a stone of player id on empty point p, reversible by undo
+    // updates bitboards, move lists, hash and disjoint set
+    vector<point>& Player = (id==1)? player1 : player2;
+    disjointSet& playerSets = (id==1)? player1Sets : player2Sets;
+    Bitboard& playerStones = (id==1)? player1Stones : player2Stones;
+    int n = toNode(p), last = emptyCells.back();
+    undoStack.push_back(moveRecord(id,p,playerSets.checkpoint(),emptyIndex[n]));
+    emptyCells[emptyIndex[n]] = last; // swap-remove n from the empty cells
+    emptyIndex[last] = emptyIndex[n];
+    emptyCells.pop_back();
+    owner[n] = id;
     Player.push_back(p);
-    for(auto v:neighborVec) // connect p to board points around p in player's graph
-        if(find(Player.begin(),Player.end(),p+v)!=Player.end()){
-            playerGraph.addEdge(toNode(p),toNode(p+v));
-            playerGraph.setCost(toNode(p),toNode(p+v),1);
-        }
+    playerStones.set(p);
+    hashKey ^= zobrist.key(id,n);
+    history.push_back(n);
+    for(int k=0; k<6; k++){ // connect p to player's stones around p
+        int m = neighbors[6*n+k];
+        if(m>=0 && owner[m]==id) playerSets.unite(n,m);
+    }
+    // connect p to the virtual border nodes it touches
+    if(id==1){
+        if(p.x==0) playerSets.unite(toNode(p),north);
+        if(p.x==size-1) playerSets.unite(toNode(p),south);
+    }else{
+        if(p.y==0) playerSets.unite(toNode(p),west);
+        if(p.y==size-1) playerSets.unite(toNode(p),east);
+    }
+}
+
+void Hex::undo(){
+    // take back the last move placed by play
+    moveRecord m = undoStack.back();
+    undoStack.pop_back();
+    vector<point>& Player = (m.id==1)? player1 : player2;
+    disjointSet& playerSets = (m.id==1)? player1Sets : player2Sets;
+    Bitboard& playerStones = (m.id==1)? player1Stones : player2Stones;
+    int n = toNode(m.p);
+    playerSets.rollback(m.setsMark);
+    owner[n] = 0;
+    emptyCells.push_back(n); // put n back at its position, the cell moved there back to the end
+    int moved = emptyCells[m.emptyPos];
+    emptyCells[m.emptyPos] = n;
+    emptyCells.back() = moved;
+    emptyIndex[moved] = emptyCells.size()-1;
+    emptyIndex[n] = m.emptyPos;
+    playerStones.reset(m.p);
+    hashKey ^= zobrist.key(m.id,n);
+    Player.pop_back();
+    history.pop_back();
+}
+
+int Hex::allocateTime(){
+    // time for the next machine move (ms): at most moveTime, and with a game budget
+    // an even split of the remaining time over the expected remaining moves, scaled
+    // by the game phase (x1.5 on the empty board, down to x0.5 on a full board),
+    // so the early and middle game get more time than the endgame
+    // a position the last search found decided (win prob beyond 0.95 either way) gets half
+    if(gameTime<=0) return moveTime;
+    const double reserve=0.05; // part of the budget kept back for latency
+    const double openingScale=1.5; // share of a move on the empty board, relative to an even split
+    const double decided=0.95; // win prob of the last search that decides the game
+    double remaining = (1-reserve)*gameTime-timeUsed[player];
+    int ownMoves = (size*size-static_cast<int>(history.size())+1)/2; // own moves to fill the board
+    double movesToGo = max(0.5*ownMoves,3.); // games rarely fill the board
+    double fill = static_cast<double>(history.size())/(size*size);
+    double share = remaining/movesToGo*max(openingScale-fill,0.5);
+    if(moveProb>=0 && (moveProb>decided || moveProb<1-decided)) share /= 2;
+    int budget = static_cast<int>(share);
+    if(moveTime>0) budget = min(budget,moveTime);
+    return max(budget,1);
+}
+
+inline bool Hex::timeUp(){
+    // check if the current machine search has passed its deadline
+    return high_resolution_clock::now()>deadline;
 }
 
 point Hex::machineMove(const vector<point>& moves){
     // AI ALGORITHMS HERE!
-    // algorithmically generate next move (mode 2, player 2)
-
-    // return machineRandomMove();
-    // return machineRightmostMove(moves);
-    return machineMCMove(moves);
+    // algorithmically generate next move for current player (mode 2 player 2, or mode 3)
+    // the search runs until the deadline and returns the best move found so far
+    auto startTime = high_resolution_clock::now();
+    deadline = startTime+milliseconds(allocateTime());
+    statsBlock* previous = statsBlock::active;
+    statsBlock::active = &stats; // search counts into this game's statistics
+    point p;
+    moveProb = -1;
+    int bookMove = (book && strategy[player]>=3)? book->lookup(openingBook::positionKey(hashKey,player)) : -1;
+    bool found = false;
+    if(bookMove>=0 && occupant(toPoint(bookMove))==0){ // book position: no search
+        p = toPoint(bookMove);
+        found = true;
+    }else if(strategy[player]>=3 && moves.size()<=solverCells){
+        // endgame: the solver gets half of the time, a proven win is played at once
+        auto searchDeadline = deadline;
+        deadline = startTime+(deadline-startTime)/2;
+        found = solve(player,p)==1;
+        deadline = searchDeadline;
+        if(found) moveProb = 1;
+    }
+    vector<point> candidates(moves); // search strategies: must-play cells without inferior cells
+    if(!found && strategy[player]>=3 && mustPlay(player,candidates)==1 && candidates.size()==1){
+        p = candidates[0]; // completes a virtual connection between the edges
+        moveProb = 1;
+        found = true;
+    }
+    if(!found && strategy[player]>=3){
+        inferior.analyse(player1Stones,player2Stones);
+        inferior.prune(player,candidates);
+    }
+    if(!found) switch(strategy[player]){
+        case 1: p = machineRandomMove(moves); break;
+        case 2: p = machineRightmostMove(moves); break;
+        case 4: p = machineMCTSMove(candidates); break;
+        case 5: p = machineAlphaBetaMove(candidates); break;
+        default: p = machineMCMove(candidates);
+    }
+    double elapsed = duration<double,milli>(high_resolution_clock::now()-startTime).count();
+    timeUsed[player] += elapsed;
+#ifdef HEX_STATS
+    stats.addMove(player,elapsed);
+#endif
+    statsBlock::active = previous;
+    return p;
 }
 
 point Hex::machineRandomMove(const vector<point>& moves){
     // dumb random move
-    return moves[rand()%moves.size()];
+    mt19937_64 rng(splitmix64(seed^round));
+    return moves[rng()%moves.size()];
 }
 
 point Hex::machineRightmostMove(const vector<point>& moves){
-    // choose rightmost move
-    if(round==1) return point(size/2,0); // first round: begins at left edge
-    else{
-        priorityQueue q;
-        auto ptr=player2.end()-1; // "rightmost" end of path
-        while(q.isEmpty()){
-            for(auto v:neighborVec)
-                if(find(moves.begin(),moves.end(),*ptr+v)!=moves.end())
-                    // possible moves around the "rightmost" end
-                    q.add(toNode(*ptr+v),(*ptr+v).y);
-            ptr--;
+    // choose rightmost move (player 2), or bottommost move (player 1)
+    vector<point>& own = (player==1)? player1 : player2;
+    point start = (player==1)? point(0,size/2) : point(size/2,0);
+    if(own.empty()) // first move: begins at own starting edge
+        return (occupant(start)==0)? start : machineRandomMove(moves);
+    priorityQueue q;
+    for(int i=own.size()-1; i>=0 && q.isEmpty(); i--) // from "rightmost" end of path backwards
+        for(int k=0; k<6; k++){
+            int n = neighbors[6*toNode(own[i])+k];
+            if(n>=0 && owner[n]==0)
+                // possible moves around the "rightmost" end
+                q.add(n,(player==1)? boardPoints[n].x : boardPoints[n].y);
         }
-        return toPoint(q.popHeadNode().label);
-    }
+    if(q.isEmpty()) return machineRandomMove(moves); // path is enclosed
+    return toPoint(q.popHeadNode().label);
 }
 
 point Hex::machineMCMove(const vector<point>& moves){
     // choose next move that has highest prob to win
-    int wins;
-    const int trials=1000; // num of trials for each possible move
+    // trials run in batches of chunk trials per move (one task each) on a worker pool,
+    // until the deadline passes or the position is decided
+    // with AMAF (strategy 6) every trial also counts for all moves the player made in it,
+    // blended into the move's value (RAVE), and search stops once the best move is stable
+    const int chunk=16; // num of trials per task
+    const int decidedTrials=200; // num of trials per move before checking if decided
+    const double decided=0.98; // win prob of a move (or loss prob of all moves) that decides the game
+    const double raveEquiv=500; // trials of a move at which its AMAF value still has weight 1/2
+    const int stableBatches=3; // num of batches the best AMAF move must lead by 2 standard errors
     double winProb;
+    bool amaf = strategy[player]==6;
     priorityQueue q; // moves that have higher win prob have higher prioirty
+    if(!pool || pool->getThreads()!=threads) pool.reset(new workerPool(threads));
+    vector<long long> wins(moves.size(),0), trials(moves.size(),0); // wins and trials of each move
+    vector<long long> amafWins(moves.size(),0), amafTrials(moves.size(),0); // all-moves-as-first wins and trials
+    vector<int> batchWins(moves.size());
+    vector<bool> batchDone(moves.size());
+    vector<Playout> kernels(pool->getThreads(),Playout(size)); // thread-local simulation state
+    vector<vector<int>> workerWins(pool->getThreads()), workerTrials(pool->getThreads()); // AMAF counts of a batch
+    vector<int> moveIndex(size*size,-1); // index in moves of each graph node
+    for(int i=0; i<moves.size(); i++) moveIndex[toNode(moves[i])] = i;
+    if(amaf)
+        for(int w=0; w<pool->getThreads(); w++){
+            workerWins[w].assign(moves.size(),0);
+            workerTrials[w].assign(moves.size(),0);
+        }
+    auto value = [&](int i){
+        // win prob of moves[i]: own trials, blended with AMAF trials while few
+        double own = static_cast<double>(wins[i])/max(trials[i],1LL);
+        if(!amaf || amafTrials[i]==0) return own;
+        double beta = sqrt(raveEquiv/(3*trials[i]+raveEquiv));
+        return (1-beta)*own+beta*amafWins[i]/amafTrials[i];
+    };
+    int leader = -1, leads = 0; // best AMAF move and num of batches it has led by 2 standard errors
+    // playouts start from the position with dead and captured cells filled in
+    // (unless a move to search was filled in itself)
+    inferior.analyse(player1Stones,player2Stones);
+    bool fill = none_of(moves.begin(),moves.end(),[&](const point& p){return inferior.isFilled(p);});
+    const Bitboard& stones1 = fill? inferior.getFilled(1) : player1Stones;
+    const Bitboard& stones2 = fill? inferior.getFilled(2) : player2Stones;
+    auto startTime = high_resolution_clock::now();
+    double budget = duration<double>(deadline-startTime).count();
 
-    for(int i=0; i<moves.size(); i++){
-        // show progress bar
-        cout << "  running: " << progressBars[i%sizeof(progressBars)] << ' ' << static_cast<int>(100.*i/moves.size()) << "%\r";
-        cout.flush();
-
-        wins = 0;
-        vector<point> shuffledMoves = moves;
-        shuffledMoves.erase(shuffledMoves.begin()+i);
-        for(int trial=0; trial<trials; trial++){
-            vector<point> start,end;
-            vector<point> player2Sim = player2; // player 2's simulated moves
-            Graph player2GraphSim = player2Graph; // graph representation of player 2's simulated moves
-            logInputtedMove(player2Sim,player2GraphSim,moves[i]); // move[i] chosen as next move
-            random_shuffle(shuffledMoves.begin(),shuffledMoves.end()); // first half as player 2's moves
-            for(int j=0; j<shuffledMoves.size()/2; j++)
-                logInputtedMove(player2Sim,player2GraphSim,shuffledMoves[j]);
-            for(auto p:player2Sim){
-                if(p.y==0) start.push_back(p); // board points on left edge (West)
-                if(p.y==size-1) end.push_back(p); // board points on right edge (East)
+    for(int batch=0; !timeUp(); batch++){
+        pool->run(moves.size(),[&](int i, int worker){
+            // move[i] chosen as next move
+            batchWins[i] = 0;
+            batchDone[i] = !timeUp(); // skipped once time is up (best move so far is kept)
+            if(!batchDone[i]) return;
+            // random stream of the task depends only on seed, round, batch and move (reproducible)
+            uint64_t task = static_cast<uint64_t>(batch)*moves.size()+i;
+            mt19937_64 rng(splitmix64(seed^splitmix64(static_cast<uint64_t>(round)<<32^task)));
+            Playout& kernel = kernels[worker];
+            kernel.setPosition(stones1,stones2);
+            kernel.play(player,moves[i]);
+            for(int trial=0; trial<chunk; trial++){
+                bool won = kernel.run(1+player%2,rng)==player;
+                batchWins[i] += won;
+                if(!amaf) continue;
+                // the player made moves[i] and every second point filled, from the second
+                workerTrials[worker][i]++;
+                workerWins[worker][i] += won;
+                for(int c=1; c<kernel.getCells(); c+=2){
+                    int j = moveIndex[toNode(kernel.getEmpty(c))];
+                    if(j<0) continue;
+                    workerTrials[worker][j]++;
+                    workerWins[worker][j] += won;
+                }
+            }
+        });
+        if(mode==2 && !quiet){
+            // show progress bar (time used), once per batch
+            double t = duration<double>(high_resolution_clock::now()-startTime).count();
+            cout << "  running: " << progressBars[batch%sizeof(progressBars)] << ' ' << min(static_cast<int>(100*t/budget),100) << "%\r";
+            cout.flush();
+        }
+        for(int i=0; i<moves.size(); i++)
+            if(batchDone[i]){
+                wins[i] += batchWins[i];
+                trials[i] += chunk;
             }
-            if(hasWon(start,end,player2GraphSim)) wins++; // player 2 wins, player 1 loses (implied)
+        if(amaf){
+            for(int w=0; w<pool->getThreads(); w++)
+                for(int i=0; i<moves.size(); i++){
+                    amafWins[i] += workerWins[w][i];
+                    amafTrials[i] += workerTrials[w][i];
+                    workerWins[w][i] = workerTrials[w][i] = 0;
+                }
+            /**** stop once the best move leads the runner-up for a few batches ****/
+            int best = 0, second = -1;
+            for(int i=1; i<moves.size(); i++){
+                if(value(i)>value(best)){
+                    second = best;
+                    best = i;
+                }else if(second<0 || value(i)>value(second)) second = i;
+            }
+            if(second<0) break; // single move
+            double v1 = value(best), v2 = value(second);
+            double error = sqrt(v1*(1-v1)/max(amafTrials[best],1LL))+sqrt(v2*(1-v2)/max(amafTrials[second],1LL));
+            leads = (best==leader && v1-v2>2*error)? leads+1 : (v1-v2>2*error)? 1 : 0;
+            leader = best;
+            if(leads>=stableBatches) break;
+        }
+        /**** stop early if the position is decided ****/
+        if(*min_element(trials.begin(),trials.end())>=decidedTrials){
+            double best = 0;
+            for(int i=0; i<moves.size(); i++) best = max(best,value(i));
+            if(best>=decided || best<=1-decided) break;
         }
-        winProb = static_cast<double>(wins)/trials;
+    }
+    for(auto& kernel:kernels) playouts += kernel.getPlayouts();
+
+    for(int i=0; i<moves.size(); i++){
+        if(trials[i]==0) continue; // not reached before the deadline
+        winProb = value(i);
         q.add(i,winProb);
     }
     // q.print();
-    return moves[q.popHeadNode().label];
+    if(q.isEmpty()) return machineRandomMove(moves); // deadline passed before any trial
+    int best = q.popHeadNode().label;
+    moveProb = value(best);
+    return moves[best];
+}
+
+point Hex::machineMCTSMove(const vector<point>& moves){
+    // choose next move by Monte Carlo tree search (UCT), until the deadline passes
+    // the subtree under the moves played since the last search is kept and re-rooted
+    STATS_TIMER(phaseMCTS);
+    const double explore=1.0; // UCT exploration constant
+    const int maxNodes=1<<22; // tree size beyond which leaves are no longer expanded
+    const int checkEvery=16; // num of iterations between deadline checks (an iteration is a playout, tens of us on large boards)
+    const int decidedVisits=1000; // num of root visits before checking if decided
+    const double decided=0.98; // win rate of the best move that decides the game
+    mt19937_64 rng(splitmix64(seed^round));
+    Playout kernel(size); // simulation workspace
+    vector<int> path; // arena indices from root to current node
+    vector<int> childMoves;
+
+    /**** re-root tree at current position ****/
+    // the tree is kept only if its root position is on the way to the current one,
+    // as moves may have been taken back since (book builder, batch evaluation)
+    int n = (tree.isEmpty() || treeStones>static_cast<int>(history.size()))? -1 : 0;
+    if(n>=0){
+        uint64_t rootKey = hashKey; // take back the moves since the root
+        for(int k=treeStones; k<history.size(); k++) rootKey ^= zobrist.key(owner[history[k]],history[k]);
+        int toMove = (treeStones<history.size())? owner[history[treeStones]] : player;
+        if(solveKey(rootKey,toMove)!=treeKey) n = -1;
+        for(int k=treeStones; k<history.size() && n>=0; k++){ // moves alternate from the root
+            n = (owner[history[k]]==toMove)? tree.findChild(n,history[k]) : -1;
+            toMove = 1+toMove%2;
+        }
+        if(n>=0 && toMove!=player) n = -1;
+    }
+    if(n<0) tree.clear();
+    else tree.reroot(n);
+    if(tree.at(0).children>0 && tree.at(0).children!=moves.size()) tree.clear(); // root moves restricted
+    treeStones = history.size();
+    treeKey = solveKey(hashKey,player);
+
+    for(int it=0; ; it++){
+        if(it%checkEvery==0 && tree.at(0).children>0){
+            if(timeUp()) break;
+            mctsNode& best = tree.at(tree.bestChild(0));
+            if(tree.at(0).visits>=decidedVisits && best.visits>0
+            && (best.wins/best.visits>=decided || best.wins/best.visits<=1-decided)) break;
+        }
+        kernel.setPosition(player1Stones,player2Stones);
+        int current = 0, toMove = player;
+        path.assign(1,0);
+        /**** selection ****/
+        while(tree.at(current).children>0){
+            mctsNode& parent = tree.at(current);
+            double bestValue = -1, value;
+            int best = parent.firstChild;
+            for(int c=parent.firstChild; c<parent.firstChild+parent.children; c++){
+                mctsNode& child = tree.at(c);
+                if(child.visits==0){ // unvisited child first
+                    best = c;
+                    break;
+                }
+                value = child.wins/child.visits+explore*sqrt(log(parent.visits)/child.visits);
+                if(value>bestValue){
+                    bestValue = value;
+                    best = c;
+                }
+            }
+            current = best;
+            kernel.play(toMove,toPoint(tree.at(current).move));
+            toMove = 1+toMove%2;
+            path.push_back(current);
+        }
+        /**** expansion ****/
+        if(tree.at(current).visits>0 && kernel.getCells()>0 && tree.getSize()+kernel.getCells()<=maxNodes){
+            childMoves.clear();
+            if(current==0) for(auto p:moves) childMoves.push_back(toNode(p)); // root: candidate moves only
+            else for(int c=0; c<kernel.getCells(); c++) childMoves.push_back(toNode(kernel.getEmpty(c)));
+            tree.expand(current,childMoves);
+            int c = rng()%childMoves.size();
+            current = tree.at(current).firstChild+c;
+            kernel.play(toMove,toPoint(childMoves[c]));
+            toMove = 1+toMove%2;
+            path.push_back(current);
+        }
+        /**** simulation: fill the board at random ****/
+        int simWinner = kernel.run(toMove,rng);
+        /**** backpropagation ****/
+        for(int d=0; d<path.size(); d++){
+            mctsNode& m = tree.at(path[d]);
+            int mover = (d%2==1)? player : 1+player%2; // player who played the move into node
+            m.visits++;
+            if(mover==simWinner) m.wins++;
+        }
+    }
+    playouts += kernel.getPlayouts();
+    mctsNode& best = tree.at(tree.bestChild(0));
+    if(best.visits>0) moveProb = best.wins/best.visits;
+    return toPoint(best.move);
 }
 
-// point machineAlphaBetaMove(const vector<point>& moves){}
+point Hex::machineAlphaBetaMove(const vector<point>& moves){
+    // alpha-beta (negamax) search with iterative deepening, until the deadline passes
+    // returns the best move of the deepest completed iteration
+    STATS_TIMER(phaseAlphaBeta);
+    const int ttBits=20; // transposition table of 2^ttBits entries
+    const int inf=2*winValue;
+    int opponent = 1+player%2;
+    if(table.isEmpty()) table.resize(ttBits);
+    table.resetStats();
+    aborted = false;
+    plyMoves.resize(moves.size()+1);
+    plyScores.resize(moves.size()+1);
+
+    /**** order root moves by heuristic (moves not scored before the deadline go last) ****/
+    vector<pair<int,point>> scored;
+    for(auto p:moves){
+        if(timeUp()){
+            scored.push_back(make_pair(-inf,p));
+            continue;
+        }
+        play(player,p);
+        scored.push_back(make_pair(getHeuristic(player),p));
+        undo();
+    }
+    stable_sort(scored.begin(),scored.end(),[](const pair<int,point>& a, const pair<int,point>& b){return a.first>b.first;});
+    vector<point> rootMoves;
+    for(auto& s:scored) rootMoves.push_back(s.second);
 
-// int Hex::getHeuristic(){
-//     // machine as max agent
-// }
+    /**** iterative deepening ****/
+    point bestMove = rootMoves[0];
+    for(int depth=1; depth<=moves.size(); depth++){
+        int alpha = -inf, best = -inf, value;
+        point iterBest = rootMoves[0];
+        for(auto p:rootMoves){
+            play(player,p);
+            if(hasWon(player,(player==1)? player1Sets : player2Sets)) value = winValue-1;
+            else value = -alphaBeta(opponent,depth-1,1,-inf,-alpha);
+            undo();
+            if(aborted) break;
+            if(value>best){
+                best = value;
+                iterBest = p;
+            }
+            alpha = max(alpha,value);
+        }
+        if(aborted) break; // incomplete iteration is discarded
+        bestMove = iterBest;
+        // search principal move first in next iteration
+        rotate(rootMoves.begin(),find(rootMoves.begin(),rootMoves.end(),bestMove),find(rootMoves.begin(),rootMoves.end(),bestMove)+1);
+        if(abs(best)>=winValue-depth) break; // game-theoretic value found
+    }
+    return bestMove;
+}
+
+int Hex::alphaBeta(int id, int depth, int ply, int alpha, int beta){
+    // negamax value of current position for player id to move
+    const int alphaOrig = alpha;
+    int opponent = 1+id%2;
+    nodes++;
+    STATS_COUNT(statNodes,1);
+    if(timeUp()) aborted = true; // nodes cost tens of us and more (circuit solves), far more than the clock
+    if(aborted) return 0;
+    if(depth==0) return getHeuristic(id);
+
+    /**** transposition table (keyed by stones and player to move) ****/
+    int ttMove = -1;
+    uint64_t key = solveKey(hashKey,id);
+    ttEntry* e = table.probe(key);
+    if(e){
+        ttMove = e->move;
+        if(e->depth>=depth){
+            int ttValue = fromTableValue(e->value,ply);
+            if(e->flag==0) return ttValue;
+            if(e->flag==1) alpha = max(alpha,ttValue);
+            else beta = min(beta,ttValue);
+            if(alpha>=beta) return ttValue;
+        }
+    }
+
+    /**** move ordering: TT move, then by current through points (near leaves: points next to stones) ****/
+    vector<point>& moves = plyMoves[ply];
+    emptyPoints(moves);
+    if(moves.size()==0) return getHeuristic(id);
+    inferior.analyse(player1Stones,player2Stones);
+    inferior.prune(id,moves);
+    int front = 0;
+    for(int i=0; i<moves.size(); i++){
+        if(toNode(moves[i])==ttMove){
+            swap(moves[i],moves[0]);
+            front = 1;
+            break;
+        }
+    }
+    if(depth>=2){
+        // points carrying most current in both players' circuits are the most critical
+        vector<double>& score = plyScores[ply];
+        if(score.empty()) score.resize(size*size);
+        circuit.resistance(1,player1Stones,player2Stones);
+        for(auto p:moves) score[toNode(p)] = circuit.getFlow(toNode(p));
+        circuit.resistance(2,player2Stones,player1Stones);
+        for(auto p:moves) score[toNode(p)] += circuit.getFlow(toNode(p));
+        sort(moves.begin()+front,moves.end(),[&](const point& a, const point& b){return score[toNode(a)]>score[toNode(b)];});
+    }else{
+        for(int i=front; i<moves.size(); i++){
+            int n = toNode(moves[i]);
+            for(int k=0; k<6; k++)
+                if(neighbors[6*n+k]>=0 && owner[neighbors[6*n+k]]!=0){
+                    swap(moves[i],moves[front++]);
+                    break;
+                }
+        }
+    }
+
+    /**** search ****/
+    int best = -2*winValue, bestMove = -1, value;
+    for(int i=0; i<moves.size(); i++){
+        point p = moves[i];
+        play(id,p);
+        if(hasWon(id,(id==1)? player1Sets : player2Sets)) value = winValue-ply-1;
+        else value = -alphaBeta(opponent,depth-1,ply+1,-beta,-alpha);
+        undo();
+        if(aborted) return 0;
+        if(value>best){
+            best = value;
+            bestMove = toNode(p);
+        }
+        alpha = max(alpha,value);
+        if(alpha>=beta) break;
+    }
+    table.store(key,depth,toTableValue(best,ply),(best<=alphaOrig)? 2 : (best>=beta)? 1 : 0,bestMove);
+    return best;
+}
+
+uint64_t Hex::solveKey(uint64_t key, int id){
+    // key of position with Zobrist hash key and player id to move
+    return key^splitmix64(0x501feULL+id);
+}
+
+bool Hex::winsAt(int id, const point& p){
+    // check if a stone of player id on empty point p would link the player's edges
+    disjointSet& playerSets = (id==1)? player1Sets : player2Sets;
+    int from = (id==1)? north : west, to = (id==1)? south : east;
+    bool touchFrom = (id==1)? p.x==0 : p.y==0, touchTo = (id==1)? p.x==size-1 : p.y==size-1;
+    int fromRoot = playerSets.findRoot(from), toRoot = playerSets.findRoot(to);
+    for(int k=0, n=toNode(p); k<6; k++)
+        if(neighbors[6*n+k]>=0 && owner[neighbors[6*n+k]]==id){
+            int r = playerSets.findRoot(neighbors[6*n+k]);
+            touchFrom = touchFrom || r==fromRoot;
+            touchTo = touchTo || r==toRoot;
+        }
+    return touchFrom && touchTo;
+}
+
+int Hex::mustPlay(int id, vector<point>& moves){
+    // restrict moves of player id to move by virtual connections (H-search)
+    // returns 1 if id wins (moves: the winning move, or kept if any move wins),
+    // -1 if id loses whatever it plays (moves kept), 0 otherwise (moves: must-play cells
+    // if the opponent threatens to connect)
+    const int vcMaxSize=19; // larger boards: 0 (H-search grows faster than the cells)
+    if(size>vcMaxSize) return 0;
+    const vcAnalysis& a = hsearch.analyse(hashKey,id,player1Stones,player2Stones);
+    if(a.status==1 && a.move>=0) moves.assign(1,toPoint(a.move));
+    if(a.status!=0 || !a.restricted) return a.status;
+    int kept = 0;
+    for(auto p:moves){
+        int n = toNode(p);
+        if(a.region[n>>6]>>(n&63)&1) moves[kept++] = p;
+    }
+    moves.resize(kept);
+    return 0;
+}
+
+int Hex::solve(int id, point& move){
+    // solve current position for player id to move by depth-first proof-number search,
+    // until the deadline
+    // returns 1 if id wins (move: a winning move), -1 if id loses, 0 if unsolved
+    const int ttBits=20; // proof-number table of 2^ttBits entries
+    if(proofTable.isEmpty()) proofTable.resize(ttBits);
+    solveMoves.resize(size*size+1);
+    solveKeys.resize(size*size+1);
+    aborted = false;
+    dfpn(id,0,pnInf,pnInf);
+    pnEntry* e = proofTable.probe(solveKey(hashKey,id));
+    if(aborted || !e || (e->phi!=0 && e->delta!=0)) return 0;
+    if(e->delta==0) return -1;
+    /**** winning move: a move to a position lost for the opponent ****/
+    vector<point> moves;
+    emptyPoints(moves);
+    for(auto p:moves){
+        if(winsAt(id,p)){
+            move = p;
+            return 1;
+        }
+        pnEntry* c = proofTable.probe(solveKey(hashKey^zobrist.key(id,toNode(p)),1+id%2));
+        if(c && c->delta==0){ // proven child (only unproven ones if evicted, or reached by transposition)
+            move = p;
+            return 1;
+        }
+    }
+    if(mustPlay(id,moves)==1){ // proven by a virtual connection
+        move = moves[0];
+        return 1;
+    }
+    return 0;
+}
+
+void Hex::dfpn(int id, int ply, uint32_t thPhi, uint32_t thDelta){
+    // depth-first proof-number search (negamax form) of current position, player id to move,
+    // until its proof number reaches thPhi or its disproof number reaches thDelta
+    // phi = min of the children's delta, delta = sum of the children's phi
+    const int vcCells=4; // num of empty cells from which virtual connections are searched
+    uint64_t key = solveKey(hashKey,id);
+    uint64_t startNodes = nodes;
+    int opponent = 1+id%2;
+    nodes++;
+    STATS_COUNT(statNodes,1);
+    if(timeUp()) aborted = true; // nodes that run H-search cost hundreds of us, far more than the clock
+    if(aborted) return;
+
+    /**** children: an immediate win proves the position, ****/
+    /**** an immediate win of the opponent must be blocked ****/
+    vector<point>& moves = solveMoves[ply];
+    vector<uint64_t>& keys = solveKeys[ply];
+    emptyPoints(moves);
+    int threats = 0;
+    point block;
+    for(auto p:moves){
+        if(winsAt(id,p)){
+            proofTable.store(key,0,pnInf,nodes-startNodes);
+            return;
+        }
+        if(winsAt(opponent,p)){
+            threats++;
+            block = p;
+        }
+    }
+    if(threats>1){ // cannot block both
+        proofTable.store(key,pnInf,0,nodes-startNodes);
+        return;
+    }
+    if(threats==1) moves.assign(1,block);
+    else if(moves.size()>=vcCells){ // virtual connections prove, disprove or narrow the position
+        int status = mustPlay(id,moves);
+        if(status!=0){
+            proofTable.store(key,(status==1)? 0 : pnInf,(status==1)? pnInf : 0,nodes-startNodes);
+            return;
+        }
+    }
+    keys.resize(moves.size());
+    for(int i=0; i<moves.size(); i++) keys[i] = solveKey(hashKey^zobrist.key(id,toNode(moves[i])),opponent);
+
+    /**** multiple iterative deepening at this node ****/
+    while(true){
+        uint64_t phi = pnInf, delta = 0, childPhi = 0;
+        uint64_t delta2 = pnInf; // second smallest child delta
+        int best = 0;
+        for(int i=0; i<moves.size(); i++){
+            pnEntry* c = proofTable.probe(keys[i]);
+            uint64_t cPhi = c? c->phi : 1, cDelta = c? c->delta : 1;
+            if(cDelta<phi){
+                delta2 = phi;
+                phi = cDelta;
+                childPhi = cPhi;
+                best = i;
+            }else if(cDelta<delta2) delta2 = cDelta;
+            delta = min(delta+cPhi,static_cast<uint64_t>(pnInf));
+        }
+        if(phi>=thPhi || delta>=thDelta || aborted){
+            proofTable.store(key,phi,delta,nodes-startNodes);
+            return;
+        }
+        // thresholds of best child (1+epsilon trick on its disproof threshold)
+        uint64_t childThPhi = min(thDelta+childPhi-delta,static_cast<uint64_t>(pnInf));
+        uint64_t childThDelta = min(static_cast<uint64_t>(thPhi),delta2+delta2/4+1);
+        point p = moves[best];
+        play(id,p);
+        dfpn(opponent,ply+1,childThPhi,childThDelta);
+        undo();
+    }
+}
+
+int Hex::solvePosition(point& move){
+    // solve current position for the player to move (time limit moveTime, none if 0)
+    // returns 1 if the player wins or has won (move: a winning move), -1 if it loses, 0 if unsolved
+    auto startTime = high_resolution_clock::now();
+    deadline = (moveTime>0)? startTime+milliseconds(moveTime) : high_resolution_clock::time_point::max();
+    nodes = 0;
+    return gameFinished()? ((winner==player)? 1 : -1) : solve(player,move);
+}
+
+void Hex::runSolver(){
+    // standalone: solve current position, report result, speed and memory
+    // (time limit moveTime, none if 0)
+    auto startTime = high_resolution_clock::now();
+    point move;
+    printBoard();
+    int result = solvePosition(move);
+    double elapsed = duration<double>(high_resolution_clock::now()-startTime).count();
+    cout << "Solver result (player " << player << " to move):\n  ";
+    if(result==1 && !gameFinished()) cout << "player " << player << " wins, winning move " << move.x << ' ' << move.y << '\n';
+    else if(result==1) cout << "player " << player << " has won\n";
+    else if(result==-1) cout << "player " << player << " loses\n";
+    else cout << "unsolved in time limit\n";
+    cout << "  nodes: " << nodes << " | time: " << elapsed << " s | nodes/s: " << static_cast<long long>(nodes/max(elapsed,1e-9)) << '\n'
+    << "  proof table: " << proofTable.getBytes()/(1<<20) << " MB" << endl;
+}
+
+int Hex::getHeuristic(int id){
+    // static value of current position for player id (higher is better)
+    // log ratio of the opponent's to player id's edge-to-edge resistance
+    Bitboard& own = (id==1)? player1Stones : player2Stones;
+    Bitboard& opp = (id==1)? player2Stones : player1Stones;
+    double ownResistance = circuit.resistance(id,own,opp);
+    double oppResistance = circuit.resistance(1+id%2,opp,own);
+    return static_cast<int>(1000*log(oppResistance/ownResistance));
+}
+
+void Hex::writeStats(){
+    // export statistics of the game's machine search as one JSON line
+    ostringstream prefix;
+    prefix << "\"size\":" << size << ",\"seed\":" << seed << ",\"strategy1\":\"" << strategyNames[strategy[1]]
+    << "\",\"strategy2\":\"" << strategyNames[strategy[2]] << "\",\"rounds\":" << round << ",\"winner\":" << winner;
+    stats.writeLine(prefix.str());
+}
+
+uint64_t Hex::rotatedKey(){
+    // Zobrist hash of current position rotated by 180 degrees (same goals for both players)
+    uint64_t key = 0;
+    for(auto& m:undoStack) key ^= zobrist.key(m.id,size*size-1-toNode(m.p));
+    return key;
+}
+
+void Hex::buildBook(const string& path, int plies){
+    // offline: search the opening positions with the machine strategy (moveTime each)
+    // and write them to the book file of path
+    // positions: the empty board, and the board after any first move of the opponent,
+    // with either player to move first; each followed by plies machine moves
+    vector<bookEntry> entries;
+    unordered_set<uint64_t> done; // keys of positions searched (or their rotations)
+    for(int first=1; first<=2; first++){
+        player = first;
+        bookLines(plies,entries,done); // machine moves first
+        for(auto p:legalMoves()){ // machine replies to a first move
+            play(first,p);
+            player = 1+first%2;
+            bookLines(plies,entries,done);
+            undo();
+            player = first;
+        }
+    }
+    if(!quiet) cout << endl;
+    if(!openingBook::write(path,size,entries)) cout << "(cannot write book " << path << ")" << endl;
+    else cout << "Book of " << entries.size() << " positions written to " << path << endl;
+}
+
+void Hex::bookLines(int plies, vector<bookEntry>& entries, unordered_set<uint64_t>& done){
+    // add book move of current position (and of its rotation), then the lines after
+    // every opponent reply (plies: num of machine moves to add)
+    if(plies==0 || gameFinished()) return;
+    uint64_t key = openingBook::positionKey(hashKey,player);
+    if(done.count(key)) return; // position or its rotation already in book
+    uint64_t rotated = openingBook::positionKey(rotatedKey(),player);
+    done.insert(key);
+    done.insert(rotated);
+    int id = player;
+    vector<point> moves = legalMoves();
+    round = history.size()+1;
+    point p = machineMove(moves);
+    entries.push_back({key,toNode(p),static_cast<int32_t>(history.size())});
+    entries.push_back({rotated,size*size-1-toNode(p),static_cast<int32_t>(history.size())});
+    if(!quiet){
+        cout << "  building: " << progressBars[done.size()/2%sizeof(progressBars)] << ' ' << done.size()/2 << " positions\r";
+        cout.flush();
+    }
+    if(plies>1){
+        play(id,p);
+        for(auto r:legalMoves()){
+            play(1+id%2,r);
+            player = id;
+            bookLines(plies-1,entries,done);
+            undo();
+        }
+        undo();
+    }
+    player = id;
+}
 
 void Hex::runGame(){
     // run the game: human vs human, or human vs machine
     welcome(); // game instructions
     seperator(50);
     chooseMode(); // game mode
+    if(mode==2) chooseStrategy(2); // machine strategy
+    if(mode==3){
+        int games = 0;
+        chooseStrategy(1);
+        chooseStrategy(2);
+        while(games<1){
+            cout << "Please choose the number of games: ";
+            cin >> games;
+        }
+        runTournament(games);
+        return;
+    }
     chooseFirstPlayer(); // first player
     while(!gameFinished()){
-        printBoard(marker); // print board before next move
+        printBoard(); // print board before next move
         inputNextMove(); // (player 1,2 alternating) call for next move
         nextPlayer(); // next player
     }
     seperator(50);
     result(); // game result
+    if(recorder) recordGame();
+#ifdef HEX_STATS
+    writeStats();
+#endif
+}
+
+int Hex::runMachineGame(){
+    // play the game between the machine strategies of both players (no console output)
+    // return winner
+    while(!gameFinished()){
+        vector<point> moves = legalMoves();
+        round++;
+        auto startTime = high_resolution_clock::now();
+        playouts = nodes = 0;
+        point p = machineMove(moves);
+        moveSeconds[player] += duration<double>(high_resolution_clock::now()-startTime).count();
+        moveCount[player]++;
+        logInputtedMove(player,p);
+        nextPlayer();
+    }
+    if(recorder) recordGame();
+#ifdef HEX_STATS
+    writeStats();
+#endif
+    return winner;
+}
+
+void Hex::runTournament(int games){
+    // machine vs machine: strategy of player 1 (N-S) against strategy of player 2 (W-E)
+    // games run concurrently on the worker pool (one search thread each),
+    // the first player alternates between games
+    const double z=1.96; // 95% confidence
+    workerPool pool(threads);
+    vector<int> winners(games);
+    vector<double> seconds1(games), seconds2(games); // time of machine moves of each game
+    vector<int> moves1(games), moves2(games); // num of machine moves of each game
+    atomic<int> done(0);
+    auto startTime = high_resolution_clock::now();
+
+    pool.run(games,[&](int g, int worker){
+        Hex game(size);
+        game.mode = 3;
+        game.strategy[1] = strategy[1];
+        game.strategy[2] = strategy[2];
+        game.player = 1+g%2;
+        game.seed = splitmix64(seed+g);
+        game.moveTime = moveTime;
+        game.gameTime = gameTime;
+        game.quiet = quiet;
+        game.solverCells = solverCells;
+        game.book = book;
+        game.recorder = recorder;
+        winners[g] = game.runMachineGame();
+        seconds1[g] = game.moveSeconds[1];
+        seconds2[g] = game.moveSeconds[2];
+        moves1[g] = game.moveCount[1];
+        moves2[g] = game.moveCount[2];
+        int d = ++done;
+        if(worker==0 && !quiet){
+            // show progress
+            cout << "  running: " << progressBars[d%sizeof(progressBars)] << ' ' << d << '/' << games << " games\r";
+            cout.flush();
+        }
+    });
+    double elapsed = duration<double>(high_resolution_clock::now()-startTime).count();
+
+    /**** statistics ****/
+    int wins1 = 0, firstWins = 0, moves1Total = 0, moves2Total = 0;
+    double seconds1Total = 0, seconds2Total = 0;
+    for(int g=0; g<games; g++){
+        wins1 += (winners[g]==1);
+        firstWins += (winners[g]==1+g%2);
+        seconds1Total += seconds1[g];
+        seconds2Total += seconds2[g];
+        moves1Total += moves1[g];
+        moves2Total += moves2[g];
+    }
+    double p = static_cast<double>(wins1)/games;
+    // Wilson score interval of player 1's win rate
+    double center = (p+z*z/(2*games))/(1+z*z/games);
+    double half = z*sqrt(p*(1-p)/games+z*z/(4.*games*games))/(1+z*z/games);
+    double lo = center-half, hi = center+half;
+    auto elo = [](double q){return 400*log10(q/(1-q));}; // Elo difference of win rate q
+    seperator(50);
+    cout <<
+    "Tournament result (" << games << " games on " << size << "*" << size << " board, " << elapsed << " s):\n"
+    "  player 1 (" << strategyNames[strategy[1]] << "): " << wins1 << " wins, win rate " << p
+    << " [" << lo << ", " << hi << "] (95% CI)\n"
+    "  player 2 (" << strategyNames[strategy[2]] << "): " << games-wins1 << " wins, win rate " << 1-p
+    << " [" << 1-hi << ", " << 1-lo << "] (95% CI)\n"
+    "  Elo difference (player 1 - player 2): ";
+    if(wins1==0 || wins1==games) cout << (wins1? "+inf" : "-inf");
+    else cout << elo(p) << " [" << elo(max(lo,1e-9)) << ", " << elo(min(hi,1-1e-9)) << "]";
+    cout << "\n"
+    "  first player win rate: " << static_cast<double>(firstWins)/games << "\n"
+    "  avg time per move: player 1 " << 1000*seconds1Total/max(moves1Total,1) << " ms"
+    ", player 2 " << 1000*seconds2Total/max(moves2Total,1) << " ms" << endl;
+}
+
+
+void Hex::evaluatePositions(istream& in, ostream& out){
+    // batch evaluation: one board per line of in (as in setPosition), searched with the strategy
+    // of player 1 for moveTime each, one search thread per position, positions spread over the
+    // worker pool; results are written in input order as soon as all earlier lines are done:
+    // <line> <player to move> <move x> <move y> <win prob> (win prob -1 if the strategy gives none,
+    // move -1 -1 if the game is over), or <line> error for a malformed board
+    // each worker keeps one engine (and its tables) for all its positions, and takes the next
+    // line while fewer than window lines per worker wait to be written, so a slow position
+    // only stalls the others once that many later lines are done
+    const int window=8; // num of positions in flight per worker (size of the reorder buffer)
+    workerPool pool(threads);
+    int capacity = window*pool.getThreads();
+    vector<unique_ptr<Hex>> engines(pool.getThreads()); // engine of each worker
+    vector<string> results(capacity); // reorder buffer: result of line l in slot l%capacity
+    vector<int8_t> ready(capacity,0); // slot holds a result not yet written
+    mutex lock; // guard of in, out and the reorder buffer
+    condition_variable room; // signal of a result written or of the end of input
+    long long lines = 0, written = 0; // num of lines read and written
+    bool inputDone = false;
+    auto startTime = high_resolution_clock::now();
+    pool.run(pool.getThreads(),[&](int, int worker){
+        if(!engines[worker]){
+            engines[worker].reset(new Hex(size));
+            Hex& game = *engines[worker];
+            game.mode = 3;
+            game.strategy[1] = game.strategy[2] = strategy[1];
+            game.moveTime = moveTime;
+            game.quiet = true;
+            game.book = book;
+            game.solverCells = solverCells;
+        }
+        Hex& game = *engines[worker];
+        string board;
+        long long line;
+        while(true){
+            {
+                unique_lock<mutex> guard(lock);
+                room.wait(guard,[&](){return inputDone || lines-written<capacity;});
+                if(inputDone || !getline(in,board)){
+                    inputDone = true;
+                    room.notify_all();
+                    return;
+                }
+                line = lines++;
+            }
+            while(!game.undoStack.empty()) game.undo(); // back to the empty board
+            game.seed = splitmix64(seed+line);
+            ostringstream result;
+            result << line+1 << ' ';
+            if(!game.setPosition(board)) result << "error";
+            else if(game.gameFinished()) result << game.player << " -1 -1 " << ((game.winner==game.player)? 1 : 0);
+            else{
+                point p = game.machineMove(game.legalMoves());
+                result << game.player << ' ' << p.x << ' ' << p.y << ' ' << game.moveProb;
+            }
+            lock_guard<mutex> guard(lock);
+            results[line%capacity] = result.str();
+            ready[line%capacity] = 1;
+            if(!ready[written%capacity]) continue;
+            while(ready[written%capacity]){
+                out << results[written%capacity] << '\n';
+                ready[written%capacity] = 0;
+                written++;
+            }
+            out.flush();
+            room.notify_all();
+        }
+    });
+    double elapsed = duration<double>(high_resolution_clock::now()-startTime).count();
+    if(!quiet) clog << lines << " positions in " << elapsed << " s (" << lines/max(elapsed,1e-9) << " positions/s)" << endl;
+}
+
+
+void Hex::recordGame(){
+    // append the finished game to the record file
+    gameRecord record;
+    record.size = size;
+    record.firstPlayer = undoStack.empty()? player : undoStack[0].id;
+    record.winner = gameFinished()? winner : 0;
+    record.strategy[0] = 0;
+    record.strategy[1] = (mode==3)? strategy[1] : 0; // human players have no strategy
+    record.strategy[2] = (mode>=2)? strategy[2] : 0;
+    record.ms[0] = 0;
+    record.ms[1] = static_cast<long long>(1000*moveSeconds[1]);
+    record.ms[2] = static_cast<long long>(1000*moveSeconds[2]);
+    record.moves = history;
+    recorder->write(record);
+}
+
+void Hex::reportRecords(const string& path){
+    // scan a record file: games, win rates and game length of each pairing of strategies
+    recordReader reader;
+    if(!reader.open(path)){
+        cout << "(no game records in " << path << ")" << endl;
+        return;
+    }
+    struct pairing{
+        long long games = 0, wins1 = 0, firstWins = 0, moves = 0, ms = 0;
+    };
+    map<tuple<int,int,int>,pairing> pairings; // by size, strategy of player 1, strategy of player 2
+    gameRecord record;
+    long long games = 0;
+    auto startTime = high_resolution_clock::now();
+    while(reader.read(record)){
+        pairing& s = pairings[make_tuple(record.size,record.strategy[1],record.strategy[2])];
+        s.games++;
+        s.wins1 += record.winner==1;
+        s.firstWins += record.winner==record.firstPlayer;
+        s.moves += record.moves.size();
+        s.ms += record.ms[1]+record.ms[2];
+        games++;
+    }
+    double elapsed = duration<double>(high_resolution_clock::now()-startTime).count();
+    auto name = [](int id){ // strategies unknown to this version by number
+        return (id==0)? string("human") : (id<=strategyCount)? strategyNames[id] : "strategy "+to_string(id);
+    };
+    cout << "Game records (" << path << "): " << games << " games, scanned in " << elapsed << " s ("
+    << static_cast<long long>(games/max(elapsed,1e-9)) << " games/s, "
+    << reader.getBytes()/max(elapsed,1e-9)/(1<<20) << " MB/s)" << endl;
+    for(auto& entry:pairings){
+        pairing& s = entry.second;
+        cout << "  " << get<0>(entry.first) << "*" << get<0>(entry.first) << ' ' << name(get<1>(entry.first))
+        << " vs " << name(get<2>(entry.first)) << ": " << s.games << " games, player 1 win rate "
+        << static_cast<double>(s.wins1)/s.games << ", first player win rate " << static_cast<double>(s.firstWins)/s.games
+        << ", avg moves " << static_cast<double>(s.moves)/s.games << ", avg ms per move " << static_cast<double>(s.ms)/max(s.moves,1LL) << endl;
+    }
 }
 
 #endif
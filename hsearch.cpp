@@ -0,0 +1,412 @@
+#ifndef HSEARCH
+#define HSEARCH
+#include "bitboard.cpp"
+#include <unordered_map>
+
+/******************************************************************************/
+/* virtual connections of one player (H-search) */
+// endpoints are empty cells (graph node x*size+y), groups of the player's stones
+// (named by one of their cells) and the player's two edges (cells, cells+1).
+// A full connection (VC) between two endpoints holds whatever the opponent plays;
+// a semi connection holds if the player plays its key first. Both come with the
+// carrier of empty cells they need. Rules:
+//   base: adjacent endpoints are fully connected (empty carrier)
+//   and:  x-z, z-y full with disjoint carriers give x-y semi (key z) if z is empty,
+//         or x-y full if z is a group
+//   or:   semis between x and y whose carriers have no common cell give x-y full
+// Carriers are flat bitsets over the cells, kept in one pool.
+struct vcLink{
+    int a,b; // endpoints (a<b)
+    int key; // key cell of a semi connection (-1 if full)
+    bool alive; // false once broken by an opponent stone
+    vcLink(int a, int b, int key):a(a),b(b),key(key),alive(true){}
+};
+
+class vcSet{
+private:
+    static const int maxFull=4; // full connections kept per endpoint pair
+    static const int maxSemi=8; // semi connections kept per endpoint pair
+    int size; // dimension of board
+    int cells; // num of board points
+    int words; // words per carrier
+    int id; // player (1: N-S, 2: W-E)
+    bool won; // a group touches both edges
+    bool valid; // connections computed
+    vector<uint64_t> ownBits,oppBits; // stones the connections were computed for
+    vector<int> rep; // endpoint of each cell (-1 if opponent stone)
+    vector<vcLink> links; // all connections
+    vector<uint64_t> pool; // carrier of each link (words per link)
+    unordered_map<uint64_t,vector<int>> fulls,semis; // links of each endpoint pair
+    vector<vector<int>> fullAt; // full links at each endpoint
+    vector<int> queue; // new full links to combine
+    vector<uint64_t> cut,span; // scratch carriers of the or rule
+    vector<int> nbor; // neighbor table, 6 entries per cell (-1 if off board)
+    uint64_t* carrier(int l);
+    uint64_t pairKey(int a, int b);
+    bool inCarrier(const uint64_t* c, int x);
+    bool subset(const uint64_t* c, const uint64_t* d);
+    void addFull(int a, int b, const uint64_t* c);
+    void addSemi(int a, int b, int key, const uint64_t* c);
+    void combine(int l);
+    void build();
+public:
+    /**** constructors ****/
+    vcSet();
+    vcSet(int size, int id);
+    /**** accessors ****/
+    bool connected();
+    int semiKey();
+    bool threatRegion(vector<uint64_t>& region);
+    int getLinks();
+    /**** mutators ****/
+    void update(const Bitboard& own, const Bitboard& opp);
+};
+
+/**** constructors ****/
+
+vcSet::vcSet():size(0),cells(0),words(0),id(0),won(false),valid(false){}
+
+vcSet::vcSet(int size, int id):rep(size*size),fullAt(size*size+2),nbor(6*size*size,-1){
+    const point neighborVec[6] = {point(0,1),point(-1,1),point(-1,0),point(0,-1),point(1,-1),point(1,0)};
+    this->size = size;
+    this->cells = size*size;
+    this->words = (cells+63)/64;
+    this->id = id;
+    this->won = false;
+    this->valid = false;
+    ownBits.assign(words,0);
+    oppBits.assign(words,0);
+    cut.assign(words,0);
+    span.assign(words,0);
+    for(int x=0; x<size; x++)
+        for(int y=0; y<size; y++)
+            for(int k=0; k<6; k++){
+                point q = point(x,y)+neighborVec[k];
+                if(q.x>=0 && q.x<size && q.y>=0 && q.y<size) nbor[6*(size*x+y)+k] = size*q.x+q.y;
+            }
+}
+
+/**** helper functions ****/
+
+inline uint64_t* vcSet::carrier(int l){return &pool[static_cast<size_t>(l)*words];}
+inline uint64_t vcSet::pairKey(int a, int b){return static_cast<uint64_t>(a)*(cells+2)+b;}
+inline bool vcSet::inCarrier(const uint64_t* c, int x){
+    // check if endpoint x is a cell in carrier c
+    return x<cells && (c[x>>6]>>(x&63)&1);
+}
+inline bool vcSet::subset(const uint64_t* c, const uint64_t* d){
+    // check if carrier c is a subset of d
+    for(int w=0; w<words; w++) if(c[w]&~d[w]) return false;
+    return true;
+}
+
+/**** accessors ****/
+
+bool vcSet::connected(){
+    // check if the player's edges are fully connected (won, or won whatever the opponent plays)
+    if(won) return true;
+    auto it = fulls.find(pairKey(cells,cells+1));
+    if(it==fulls.end()) return false;
+    for(auto l:it->second) if(links[l].alive) return true;
+    return false;
+}
+
+int vcSet::semiKey(){
+    // key cell of a semi connection between the edges (-1 if none): playing it wins
+    auto it = semis.find(pairKey(cells,cells+1));
+    if(it==semis.end()) return -1;
+    for(auto l:it->second) if(links[l].alive) return links[l].key;
+    return -1;
+}
+
+bool vcSet::threatRegion(vector<uint64_t>& region){
+    // cells that meet every semi connection between the edges (carrier and key);
+    // the opponent, to move, must play there. Returns false if there is no such threat
+    auto it = semis.find(pairKey(cells,cells+1));
+    bool threat = false;
+    region.assign(words,~0ULL);
+    if(it==semis.end()) return false;
+    for(auto l:it->second){
+        if(!links[l].alive) continue;
+        uint64_t* c = carrier(l);
+        int k = links[l].key;
+        for(int w=0; w<words; w++) region[w] &= c[w]|((k>>6)==w? 1ULL<<(k&63) : 0);
+        threat = true;
+    }
+    return threat;
+}
+
+int vcSet::getLinks(){
+    // num of connections found
+    return links.size();
+}
+
+/**** algorithms ****/
+
+void vcSet::addFull(int a, int b, const uint64_t* c){
+    // add full connection a-b with carrier c, unless a known one needs no more cells
+    if(a>b) swap(a,b);
+    vector<int>& list = fulls[pairKey(a,b)];
+    int alive = 0;
+    for(auto l:list){
+        if(!links[l].alive) continue;
+        if(subset(carrier(l),c)) return;
+        alive++;
+    }
+    if(alive>=maxFull) return;
+    STATS_COUNT(statNodes,1);
+    int l = links.size();
+    links.push_back(vcLink(a,b,-1));
+    pool.insert(pool.end(),c,c+words);
+    list.push_back(l);
+    fullAt[a].push_back(l);
+    fullAt[b].push_back(l);
+    queue.push_back(l);
+}
+
+void vcSet::addSemi(int a, int b, int key, const uint64_t* c){
+    // add semi connection a-b with key and carrier c (key included), then apply the or rule
+    if(a>b) swap(a,b);
+    auto fl = fulls.find(pairKey(a,b));
+    if(fl!=fulls.end())
+        for(auto l:fl->second) if(links[l].alive && subset(carrier(l),c)) return;
+    vector<int>& list = semis[pairKey(a,b)];
+    int alive = 0;
+    for(auto l:list){
+        if(!links[l].alive) continue;
+        if(subset(carrier(l),c)) return;
+        alive++;
+    }
+    if(alive>=maxSemi) return;
+    int s = links.size();
+    links.push_back(vcLink(a,b,key));
+    pool.insert(pool.end(),c,c+words);
+    list.push_back(s);
+    /**** or rule: intersect carriers until no cell is common ****/
+    copy(c,c+words,cut.begin());
+    copy(c,c+words,span.begin());
+    for(auto l:list){
+        if(l==s || !links[l].alive) continue;
+        uint64_t* d = carrier(l);
+        bool shrinks = false;
+        for(int w=0; w<words; w++) if(cut[w]&~d[w]) shrinks = true;
+        if(!shrinks) continue;
+        bool empty = true;
+        for(int w=0; w<words; w++){
+            cut[w] &= d[w];
+            span[w] |= d[w];
+            if(cut[w]) empty = false;
+        }
+        if(empty){
+            vector<uint64_t> c2(span); // addFull may grow the pool
+            addFull(a,b,c2.data());
+            return;
+        }
+    }
+}
+
+void vcSet::combine(int l){
+    // and rule: combine new full link l with the full links at either of its endpoints
+    vector<uint64_t> c(words), d(words);
+    for(int side=0; side<2; side++){
+        int m = side? links[l].b : links[l].a; // middle endpoint
+        int x = side? links[l].a : links[l].b;
+        if(m>=cells) continue; // not through an edge
+        bool empty = rep[m]==m && !(ownBits[m>>6]>>(m&63)&1);
+        for(int i=0; i<fullAt[m].size(); i++){
+            int k = fullAt[m][i];
+            if(k==l || !links[k].alive) continue;
+            int y = (links[k].a==m)? links[k].b : links[k].a;
+            if(y==x) continue;
+            const uint64_t* cl = carrier(l);
+            const uint64_t* ck = carrier(k);
+            bool disjoint = true;
+            for(int w=0; w<words && disjoint; w++) if(cl[w]&ck[w]) disjoint = false;
+            if(!disjoint || inCarrier(cl,y) || inCarrier(ck,x)) continue;
+            for(int w=0; w<words; w++) c[w] = cl[w]|ck[w];
+            if(empty){
+                c[m>>6] |= 1ULL<<(m&63);
+                addSemi(x,y,m,c.data());
+            }else addFull(x,y,c.data());
+        }
+    }
+}
+
+void vcSet::build(){
+    // compute all connections of the position in ownBits/oppBits
+    links.clear();
+    pool.clear();
+    fulls.clear();
+    semis.clear();
+    queue.clear();
+    for(auto& f:fullAt) f.clear();
+    won = false;
+    /**** groups (flood fill of own stones), named by an edge they touch or a cell ****/
+    for(int c=0; c<cells; c++) rep[c] = (oppBits[c>>6]>>(c&63)&1)? -1 : c;
+    vector<int> stack;
+    vector<bool> seen(cells,false);
+    for(int c=0; c<cells; c++){
+        if(!(ownBits[c>>6]>>(c&63)&1) || seen[c]) continue;
+        vector<int> group;
+        bool touchA = false, touchB = false;
+        stack.assign(1,c);
+        seen[c] = true;
+        while(!stack.empty()){
+            int s = stack.back();
+            stack.pop_back();
+            group.push_back(s);
+            int line = (id==1)? s/size : s%size;
+            touchA = touchA || line==0;
+            touchB = touchB || line==size-1;
+            for(int k=0; k<6; k++){
+                int t = nbor[6*s+k];
+                if(t>=0 && !seen[t] && (ownBits[t>>6]>>(t&63)&1)){
+                    seen[t] = true;
+                    stack.push_back(t);
+                }
+            }
+        }
+        if(touchA && touchB) won = true;
+        int name = touchA? cells : touchB? cells+1 : c;
+        for(auto s:group) rep[s] = name;
+    }
+    if(won) return;
+    /**** base: adjacent endpoints ****/
+    vector<uint64_t> none(words,0);
+    for(int c=0; c<cells; c++){
+        if(rep[c]<0) continue;
+        int line = (id==1)? c/size : c%size;
+        if(line==0 && rep[c]!=cells) addFull(rep[c],cells,none.data());
+        if(line==size-1 && rep[c]!=cells+1) addFull(rep[c],cells+1,none.data());
+        for(int k=0; k<6; k++){
+            int t = nbor[6*c+k];
+            if(t>c && rep[t]>=0 && rep[t]!=rep[c]) addFull(rep[c],rep[t],none.data());
+        }
+    }
+    /**** closure ****/
+    for(int i=0; i<queue.size(); i++) combine(queue[i]);
+    queue.clear();
+}
+
+/**** mutators ****/
+
+void vcSet::update(const Bitboard& own, const Bitboard& opp){
+    // bring the connections to the position (own/opp: stones of the player and the opponent)
+    // if only opponent stones were added, the broken connections are dropped (no new
+    // connection can arise), otherwise all connections are computed again
+    vector<uint64_t> newOwn(words,0), newOpp(words,0);
+    for(int c=0; c<cells; c++){
+        point p(c/size,c%size);
+        if(own.test(p)) newOwn[c>>6] |= 1ULL<<(c&63);
+        if(opp.test(p)) newOpp[c>>6] |= 1ULL<<(c&63);
+    }
+    bool extends = valid && newOwn==ownBits;
+    for(int w=0; w<words && extends; w++) if(oppBits[w]&~newOpp[w]) extends = false;
+    if(!extends){
+        ownBits = newOwn;
+        oppBits = newOpp;
+        build();
+        valid = true;
+        return;
+    }
+    for(int w=0; w<words; w++){
+        uint64_t added = newOpp[w]&~oppBits[w];
+        if(!added) continue;
+        for(int l=0; l<links.size(); l++){
+            if(!links[l].alive) continue;
+            const uint64_t* c = carrier(l);
+            bool endpoint = links[l].a<cells && (links[l].a>>6)==w && (added>>(links[l].a&63)&1);
+            endpoint = endpoint || (links[l].b<cells && (links[l].b>>6)==w && (added>>(links[l].b&63)&1));
+            if((c[w]&added) || endpoint) links[l].alive = false;
+        }
+        for(int c=64*w; c<min(64*(w+1),cells); c++) if(added>>(c&63)&1) rep[c] = -1;
+    }
+    oppBits = newOpp;
+}
+
+/******************************************************************************/
+/* H-search of both players, with a cache of position analyses */
+struct vcAnalysis{
+    uint64_t key; // position key (0 if empty)
+    int status; // for the player to move: 1 wins, -1 loses, 0 unknown
+    int move; // winning move if status is 1 (-1 if any move wins)
+    bool restricted; // must play in region
+    vector<uint64_t> region; // cells the player to move must play in
+};
+
+class HSearch{
+private:
+    static const int cacheBits=12; // cache of 2^cacheBits analyses
+    int size; // dimension of board
+    int cells; // num of board points
+    vcSet sets[3]; // connections of player 1 and 2
+    vector<vcAnalysis> cache; // analyses, indexed by low bits of key
+    long long lookups,hits; // cache statistics
+public:
+    /**** constructors ****/
+    HSearch();
+    HSearch(int size);
+    /**** accessors ****/
+    double getHitRate();
+    vcSet& connections(int id);
+    /**** algorithms ****/
+    const vcAnalysis& analyse(uint64_t key, int toMove, const Bitboard& stones1, const Bitboard& stones2);
+};
+
+/**** constructors ****/
+
+HSearch::HSearch():size(0),cells(0),lookups(0),hits(0){}
+
+HSearch::HSearch(int size):cache(1<<cacheBits){
+    this->size = size;
+    this->cells = size*size;
+    this->lookups = this->hits = 0;
+    sets[1] = vcSet(size,1);
+    sets[2] = vcSet(size,2);
+    for(auto& a:cache) a.key = 0;
+}
+
+/**** accessors ****/
+
+double HSearch::getHitRate(){
+    return lookups? static_cast<double>(hits)/lookups : 0;
+}
+
+vcSet& HSearch::connections(int id){
+    // connections of player id as of the last analysis computed
+    return sets[id];
+}
+
+/**** algorithms ****/
+
+const vcAnalysis& HSearch::analyse(uint64_t key, int toMove, const Bitboard& stones1, const Bitboard& stones2){
+    // status and must-play region of the position for player toMove (key: its Zobrist hash)
+    uint64_t k = key^splitmix64(0x7c5ULL+toMove);
+    vcAnalysis& a = cache[k&((1<<cacheBits)-1)];
+    lookups++;
+    if(a.key==k){
+        hits++;
+        return a;
+    }
+    int opponent = 1+toMove%2;
+    vcSet& own = sets[toMove];
+    vcSet& opp = sets[opponent];
+    own.update((toMove==1)? stones1 : stones2,(toMove==1)? stones2 : stones1);
+    opp.update((opponent==1)? stones1 : stones2,(opponent==1)? stones2 : stones1);
+    a.key = k;
+    a.status = 0;
+    a.move = -1;
+    a.restricted = false;
+    if(own.connected()) a.status = 1; // any move keeps the connection
+    else if((a.move = own.semiKey())>=0) a.status = 1;
+    else if(opp.connected()) a.status = -1;
+    else if(opp.threatRegion(a.region)){
+        a.restricted = true;
+        bool any = false;
+        for(auto w:a.region) any = any || w;
+        if(!any) a.status = -1; // threats cannot all be stopped
+    }
+    return a;
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef INFERIOR
+#define INFERIOR
+#include "bitboard.cpp"
+
+/******************************************************************************/
+/* inferior cell analysis (local patterns on the six neighbors of a cell) */
+// dead:      the cell's color cannot matter to either player, because four
+//            consecutive neighbors belong to one player, or three to one player
+//            and the other three to the other (edges count as their player's stones)
+// captured:  two adjacent empty cells that a player answers inside, leaving the
+//            intruding stone dead
+// dominated: a cell that dies once the player to move takes an empty neighbor,
+//            which is then at least as good a move
+// Dead cells (filled for player 1) and captured cells (filled for their captor)
+// are filled in until no pattern matches; the filled position has the same
+// winner, so neither player needs to play there.
+class InferiorCells{
+private:
+    int size; // dimension of board
+    vector<int8_t> color; // occupant of each point after fill-in (0: empty)
+    vector<int8_t> dominated; // scratch flags of prune
+    vector<int> work; // cells to test in analyse
+    vector<int8_t> queued; // cells in work
+    int dead,captured; // num of cells filled in as dead or captured by the last analysis
+    Bitboard filled1,filled2; // stones of player 1 and 2 after fill-in
+    const vector<point> neighborVec{point(0,1),point(-1,1),point(-1,0),point(0,-1),point(1,-1),point(1,0)}; // in cyclic order
+    // helper functions
+    bool inBoard(const point& p){return p.x>=0 && p.x<size && p.y>=0 && p.y<size;}
+    int occupant(const point& p);
+    void wake(const point& p);
+    bool isDead(const point& p);
+public:
+    /**** constructors ****/
+    InferiorCells();
+    InferiorCells(int size);
+    /**** accessors ****/
+    int getDead();
+    int getCaptured();
+    bool isFilled(const point& p);
+    const Bitboard& getFilled(int id);
+    /**** algorithms ****/
+    void analyse(const Bitboard& stones1, const Bitboard& stones2);
+    void prune(int id, vector<point>& moves);
+};
+
+/**** constructors ****/
+
+InferiorCells::InferiorCells():size(0),dead(0),captured(0){}
+
+InferiorCells::InferiorCells(int size):color(size*size,0),dominated(size*size,0),queued(size*size,0),filled1(size),filled2(size){
+    this->size = size;
+    this->dead = 0;
+    this->captured = 0;
+}
+
+/**** helper functions ****/
+
+int InferiorCells::occupant(const point& p){
+    // player owning point p (0 if empty), off board: player of that edge
+    // (-1 beyond a corner, where the edges of both players meet)
+    bool xOut = p.x<0 || p.x>=size, yOut = p.y<0 || p.y>=size;
+    if(xOut && yOut) return -1;
+    if(xOut) return 1;
+    if(yOut) return 2;
+    return color[size*p.x+p.y];
+}
+
+void InferiorCells::wake(const point& p){
+    // queue the empty cells within two steps of point p
+    for(auto v:neighborVec)
+        for(auto w:neighborVec){
+            point q = p+v+w;
+            if(!inBoard(q) || color[size*q.x+q.y]!=0 || queued[size*q.x+q.y]) continue;
+            queued[size*q.x+q.y] = 1;
+            work.push_back(size*q.x+q.y);
+        }
+}
+
+bool InferiorCells::isDead(const point& p){
+    // check the dead patterns around point p
+    int c[12];
+    for(int k=0; k<6; k++) c[k] = c[k+6] = occupant(p+neighborVec[k]);
+    for(int k=0; k<6; k++){
+        int id = c[k];
+        if(id<=0 || c[k+1]!=id || c[k+2]!=id) continue;
+        if(c[k+3]==id) return true; // four in a row
+        if(c[k+3]==3-id && c[k+4]==3-id && c[k+5]==3-id) return true; // three and three
+    }
+    return false;
+}
+
+/**** accessors ****/
+
+int InferiorCells::getDead(){
+    return dead;
+}
+
+int InferiorCells::getCaptured(){
+    return captured;
+}
+
+bool InferiorCells::isFilled(const point& p){
+    // check if empty point p was filled in by the last analysis
+    return color[size*p.x+p.y]!=0;
+}
+
+const Bitboard& InferiorCells::getFilled(int id){
+    // stones of player id after fill-in
+    return (id==1)? filled1 : filled2;
+}
+
+/**** algorithms ****/
+
+void InferiorCells::analyse(const Bitboard& stones1, const Bitboard& stones2){
+    // fill in dead and captured cells of a position
+    // (worklist of empty cells: a fill only changes the patterns of cells within two steps)
+    filled1 = stones1;
+    filled2 = stones2;
+    work.clear();
+    for(int x=0; x<size; x++)
+        for(int y=0; y<size; y++){
+            int n = size*x+y;
+            color[n] = stones1.test(point(x,y))? 1 : stones2.test(point(x,y))? 2 : 0;
+            queued[n] = color[n]==0;
+            if(queued[n]) work.push_back(n);
+        }
+    dead = captured = 0;
+    while(!work.empty()){
+        int n = work.back();
+        work.pop_back();
+        queued[n] = 0;
+        point a(n/size,n%size);
+        if(color[n]!=0) continue;
+        int occupied = 0; // both patterns need at least 3 occupied neighbors
+        for(auto v:neighborVec) occupied += occupant(a+v)!=0;
+        if(occupied<3) continue;
+        if(isDead(a)){
+            color[n] = 1;
+            filled1.set(a);
+            dead++;
+            wake(a);
+            continue;
+        }
+        // pairs with a neighbor b: captured by id if either cell dies once id holds the other
+        for(int k=0; k<6 && color[n]==0; k++){
+            point b = a+neighborVec[k];
+            if(!inBoard(b) || color[size*b.x+b.y]!=0) continue;
+            for(int id=1; id<=2; id++){
+                color[size*b.x+b.y] = id;
+                bool captures = isDead(a);
+                color[size*b.x+b.y] = 0;
+                if(!captures) continue;
+                color[n] = id;
+                captures = isDead(b);
+                if(!captures){
+                    color[n] = 0;
+                    continue;
+                }
+                color[size*b.x+b.y] = id;
+                Bitboard& filled = (id==1)? filled1 : filled2;
+                filled.set(a);
+                filled.set(b);
+                captured += 2;
+                wake(a);
+                wake(b);
+                break;
+            }
+        }
+    }
+}
+
+void InferiorCells::prune(int id, vector<point>& moves){
+    // drop filled-in and dominated moves of player id to move (after analyse)
+    // a cell is only dropped for a dominating move that is kept, and moves stay
+    // unchanged if nothing would be left
+    for(auto p:moves) dominated[size*p.x+p.y] = 2; // 2: candidate
+    for(auto p:moves){
+        if(color[size*p.x+p.y]!=0){
+            dominated[size*p.x+p.y] = 1;
+            continue;
+        }
+        for(auto v:neighborVec){
+            point d = p+v;
+            if(!inBoard(d) || color[size*d.x+d.y]!=0 || dominated[size*d.x+d.y]!=2) continue;
+            color[size*d.x+d.y] = id;
+            bool dies = isDead(p);
+            color[size*d.x+d.y] = 0;
+            if(dies){
+                dominated[size*p.x+p.y] = 1;
+                break;
+            }
+        }
+    }
+    int kept = 0, n = 0;
+    for(auto p:moves) kept += dominated[size*p.x+p.y]==2;
+    for(int i=0; i<moves.size(); i++){
+        point p = moves[i];
+        bool keep = kept==0 || dominated[size*p.x+p.y]==2;
+        dominated[size*p.x+p.y] = 0;
+        if(keep) moves[n++] = p;
+    }
+    moves.resize(n);
+}
+
+#endif
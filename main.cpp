@@ -3,11 +3,66 @@ Hex game and AI - 12/4/2020
 */
 #include "hex.cpp"
 
-int main(){
+int main(int argc, char** argv){
+    // options: -t <threads> (machine search workers), -s <seed> (machine search seed),
+    // -n <size> (board size), -m <ms> (machine search time limit per move),
+    // -c <ms> (machine search time budget per player per game),
+    // -g <games> -1 <strategy> -2 <strategy> (headless machine vs machine tournament),
+    // -q (no progress output), -j <file> (statistics JSON lines file, built with -DHEX_STATS),
+    // -b <file> (opening book), -o <file> -p <plies> (build opening book with strategy -1),
+    // -e <cells> (empty cells from which machine search solves the position, 0: never),
+    // -S <board> (solve position: size*size cells of X, O or ., time limit -m, 0: none),
+    // -i <file> (evaluate one board per line with strategy -1, - for standard input),
+    // -w <file> (append finished games to a game record file), -r <file> (summarize a game record file)
     srand(clock());
-    int size;
+    int threads = max(static_cast<int>(thread::hardware_concurrency()),1);
+    uint64_t seed = static_cast<uint64_t>(high_resolution_clock::now().time_since_epoch().count());
+    int size = 0, moveTime = 1000, gameTime = 0, games = 0, strategy1 = 3, strategy2 = 3;
+    int plies = 1;
+    bool quiet = false;
+    int solverCells = 25;
+    string bookPath = "", buildPath = "", board = "", inputPath = "", writePath = "", readPath = "";
+    for(int i=1; i<argc; i++){
+        string opt = argv[i];
+        if(opt=="-q"){
+            quiet = true;
+            continue;
+        }
+        if(i+1>=argc) break;
+        if(opt=="-j" || opt=="-b" || opt=="-o" || opt=="-S" || opt=="-i" || opt=="-w" || opt=="-r"){
+            string& path = (opt=="-j")? statsBlock::output : (opt=="-b")? bookPath : (opt=="-o")? buildPath
+            : (opt=="-S")? board : (opt=="-i")? inputPath : (opt=="-w")? writePath : readPath;
+            path = argv[++i];
+            continue;
+        }
+        if(!isInt(argv[i+1])) continue;
+        if(opt=="-t") threads = stoi(argv[i+1]);
+        else if(opt=="-s") seed = stoull(argv[i+1]);
+        else if(opt=="-n") size = stoi(argv[i+1]);
+        else if(opt=="-m") moveTime = stoi(argv[i+1]);
+        else if(opt=="-c") gameTime = stoi(argv[i+1]);
+        else if(opt=="-g") games = stoi(argv[i+1]);
+        else if(opt=="-1") strategy1 = stoi(argv[i+1]);
+        else if(opt=="-2") strategy2 = stoi(argv[i+1]);
+        else if(opt=="-p") plies = stoi(argv[i+1]);
+        else if(opt=="-e") solverCells = stoi(argv[i+1]);
+        else continue;
+        i++;
+    }
+    if(strategy1<1 || strategy1>strategyCount || strategy2<1 || strategy2>strategyCount){
+        cout << "(strategy must be 1-" << strategyCount << ")" << endl;
+        return 0;
+    }
+    if(!readPath.empty()){ // game records
+        Hex::reportRecords(readPath);
+        return 0;
+    }
+    if(!inputPath.empty() && size<1){
+        cout << "(batch evaluation needs the board size -n)" << endl;
+        return 0;
+    }
     string inputSize;
-    while(true){
+    while(size<1){
         cout << "Choose a board (e.g. enter 7 for a 7*7 game board): ";
         cin >> inputSize;
         if(!isInt(inputSize)){
@@ -17,7 +72,42 @@ int main(){
         size = stoi(inputSize);
         break;
     }
-    seperator(50);
+    if(inputPath.empty()) seperator(50); // batch output: results only
     Hex hex(size); // instantiate Hex game
+    hex.setThreads(threads);
+    hex.setSeed(seed);
+    hex.setMoveTime(moveTime);
+    hex.setGameTime(gameTime);
+    hex.setQuiet(quiet);
+    hex.setSolverCells(solverCells);
+    if(!board.empty()){ // standalone solver
+        if(!hex.setPosition(board)) cout << "(position needs " << size*size << " cells of X, O or .)" << endl;
+        else hex.runSolver();
+        return 0;
+    }
+    if(!buildPath.empty()){ // offline opening book
+        hex.setStrategy(1,strategy1);
+        hex.setStrategy(2,strategy1);
+        hex.buildBook(buildPath,plies);
+        return 0;
+    }
+    if(!writePath.empty() && !hex.openRecords(writePath))
+        cout << "(cannot write game records to " << writePath << ")" << endl;
+    if(!bookPath.empty() && !hex.loadBook(bookPath))
+        cout << "(no opening book for " << size << "*" << size << " board in " << bookPath << ")" << endl;
+    if(!inputPath.empty()){ // batch evaluation
+        hex.setStrategy(1,strategy1);
+        ifstream file;
+        if(inputPath!="-") file.open(inputPath);
+        if(inputPath!="-" && !file) cout << "(cannot read " << inputPath << ")" << endl;
+        else hex.evaluatePositions((inputPath=="-")? cin : file,cout);
+        return 0;
+    }
+    if(games>0){ // headless tournament
+        hex.setStrategy(1,strategy1);
+        hex.setStrategy(2,strategy2);
+        hex.runTournament(games);
+        return 0;
+    }
     hex.runGame(); // run the game (play on terminal)
 }
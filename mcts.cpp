@@ -0,0 +1,102 @@
+#ifndef MCTS
+#define MCTS
+#include "stats.cpp"
+
+/******************************************************************************/
+/* Monte Carlo search tree (nodes pooled in a flat arena) */
+struct mctsNode{
+    // tree node, children of a node are stored contiguously
+    int move; // graph node played to reach this node (-1 for initial root)
+    int firstChild; // arena index of first child (-1 if not expanded)
+    int children; // number of children
+    int visits; // num of playouts through this node
+    float wins; // wins of the player who played move
+    mctsNode(int move):move(move),firstChild(-1),children(0),visits(0),wins(0){}
+};
+
+class mctsTree{
+private:
+    vector<mctsNode> arena; // node pool, root at index 0
+    vector<mctsNode> spare; // pool reused when re-rooting
+public:
+    /**** constructors ****/
+    mctsTree();
+    /**** accessors ****/
+    int getSize();
+    bool isEmpty();
+    mctsNode& at(int n);
+    int findChild(int n, int move);
+    int bestChild(int n);
+    /**** mutators ****/
+    void clear();
+    void expand(int n, const vector<int>& moves);
+    void reroot(int n);
+};
+
+/**** constructors ****/
+
+mctsTree::mctsTree(){}
+
+/**** accessors ****/
+
+int mctsTree::getSize(){
+    // number of nodes in tree
+    return arena.size();
+}
+
+bool mctsTree::isEmpty(){
+    // check if tree has no root
+    return arena.empty();
+}
+
+mctsNode& mctsTree::at(int n){
+    // node at arena index n
+    return arena[n];
+}
+
+int mctsTree::findChild(int n, int move){
+    // arena index of the child of n reached by move (-1 if absent)
+    for(int c=arena[n].firstChild; c<arena[n].firstChild+arena[n].children; c++)
+        if(arena[c].move==move) return c;
+    return -1;
+}
+
+int mctsTree::bestChild(int n){
+    // arena index of the most visited child of n
+    int best = arena[n].firstChild;
+    for(int c=arena[n].firstChild; c<arena[n].firstChild+arena[n].children; c++)
+        if(arena[c].visits>arena[best].visits) best = c;
+    return best;
+}
+
+/**** mutators ****/
+
+void mctsTree::clear(){
+    // reset to a single unexpanded root
+    arena.clear();
+    arena.push_back(mctsNode(-1));
+}
+
+void mctsTree::expand(int n, const vector<int>& moves){
+    // append one child per move to node n
+    STATS_COUNT(statNodes,1);
+    if(arena.size()+moves.size()>arena.capacity()) STATS_COUNT(statAllocations,1);
+    arena[n].firstChild = arena.size();
+    arena[n].children = moves.size();
+    for(auto m:moves) arena.push_back(mctsNode(m));
+}
+
+void mctsTree::reroot(int n){
+    // keep only the subtree under node n, compacted with n as root
+    spare.clear();
+    spare.push_back(arena[n]);
+    for(int i=0; i<spare.size(); i++){ // breadth first copy of children blocks
+        if(spare[i].firstChild<0) continue;
+        int first = spare[i].firstChild;
+        spare[i].firstChild = spare.size();
+        for(int c=first; c<first+spare[i].children; c++) spare.push_back(arena[c]);
+    }
+    arena.swap(spare);
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef PARALLEL
+#define PARALLEL
+#include "stats.cpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+/******************************************************************************/
+/* worker pool (work stealing over per-worker task queues) */
+// the workers are started once by the constructor and sleep between runs,
+// so a run only wakes them up and waits until all tasks are done
+class workerPool{
+private:
+    int threads; // number of workers (the calling thread is worker 0)
+    vector<deque<int>> queues; // task queue of each worker
+    vector<mutex> locks; // guard of each task queue
+    vector<thread> workers; // threads of workers 1..threads-1
+    mutex poolLock; // guard of the run state below
+    condition_variable wakeUp,allDone; // signal of a new run, and of the last worker finished
+    const function<void(int,int)>* job; // job of the current run
+    statsBlock* stats; // statistics the current run counts into
+    uint64_t generation; // num of runs started
+    int busy; // num of workers still working on the current run
+    bool stopping; // pool is being destroyed
+    bool nextTask(int worker, int& task);
+    void work(int worker);
+    void serve(int worker);
+public:
+    /**** constructors ****/
+    workerPool(int threads);
+    workerPool(const workerPool&) = delete;
+    workerPool& operator=(const workerPool&) = delete;
+    /**** destructor ****/
+    ~workerPool();
+    /**** accessors ****/
+    int getThreads();
+    /**** algorithms ****/
+    void run(int tasks, const function<void(int,int)>& job);
+};
+
+/**** constructors ****/
+
+workerPool::workerPool(int threads):queues(max(threads,1)),locks(max(threads,1)),job(0),stats(0),generation(0),busy(0),stopping(false){
+    this->threads = max(threads,1);
+    for(int w=1; w<this->threads; w++) workers.push_back(thread(&workerPool::serve,this,w));
+}
+
+/**** destructor ****/
+
+workerPool::~workerPool(){
+    {
+        lock_guard<mutex> lock(poolLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for(auto& t:workers) t.join();
+}
+
+/**** accessors ****/
+
+int workerPool::getThreads(){
+    // number of workers
+    return threads;
+}
+
+bool workerPool::nextTask(int worker, int& task){
+    // pop a task from own queue (back), else steal from other queues (front)
+    {
+        lock_guard<mutex> lock(locks[worker]);
+        if(!queues[worker].empty()){
+            task = queues[worker].back();
+            queues[worker].pop_back();
+            return true;
+        }
+    }
+    for(int i=1; i<threads; i++){
+        int victim = (worker+i)%threads;
+        lock_guard<mutex> lock(locks[victim]);
+        if(!queues[victim].empty()){
+            task = queues[victim].front();
+            queues[victim].pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void workerPool::work(int worker){
+    // run tasks of the current job until all queues are empty
+    statsBlock::active = stats; // workers count into the caller's statistics
+    int task;
+    while(nextTask(worker,task)) (*job)(task,worker);
+}
+
+void workerPool::serve(int worker){
+    // loop of worker thread: sleep until a run starts, work on it, report when done
+    uint64_t seen = 0;
+    unique_lock<mutex> lock(poolLock);
+    while(true){
+        wakeUp.wait(lock,[&](){return stopping || generation!=seen;});
+        if(stopping) return;
+        seen = generation;
+        lock.unlock();
+        work(worker);
+        lock.lock();
+        if(--busy==0) allDone.notify_one();
+    }
+}
+
+/**** algorithms ****/
+
+void workerPool::run(int tasks, const function<void(int,int)>& job){
+    // run job(task,worker) for task = 0..tasks-1, blocks until all done
+    // tasks are dealt in contiguous blocks, idle workers steal the rest
+    // (workers are asleep here, so the queues are filled without their locks)
+    for(int w=0; w<threads; w++){
+        queues[w].clear();
+        for(int t=w*tasks/threads; t<(w+1)*tasks/threads; t++)
+            queues[w].push_front(t); // own tasks popped from back in ascending order
+    }
+    {
+        lock_guard<mutex> lock(poolLock);
+        this->job = &job;
+        this->stats = statsBlock::active;
+        busy = threads-1;
+        generation++;
+    }
+    wakeUp.notify_all();
+    work(0);
+    unique_lock<mutex> lock(poolLock);
+    allDone.wait(lock,[&](){return busy==0;});
+}
+
+#endif
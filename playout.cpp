@@ -0,0 +1,156 @@
+#ifndef PLAYOUT
+#define PLAYOUT
+#include "bitboard.cpp"
+
+/******************************************************************************/
+/* fixed-size playout finish (board dimension N known at compile time) */
+// the board is one word per row on the stack, so the fill and the flood fill
+// run over constant bounds and masks that the compiler unrolls
+template<int N>
+int fixedFinish(const Bitboard& stones1, const point* cells, int count, int first){
+    // fill player 1's stones at cells[first], cells[first+2], ... into stones1, return winner
+    static_assert(N>0 && N<64,"one word per row");
+    uint64_t s[N], r[N];
+    for(int x=0; x<N; x++) s[x] = stones1.getRow(x)[0];
+    for(int i=first; i<count; i+=2) s[cells[i].x] |= 1ULL<<cells[i].y;
+    /**** flood fill from the north edge (row x touches row x-1 at y,y+1 and row x+1 at y-1,y) ****/
+    auto spread = [](uint64_t w, uint64_t m){
+        // fill the runs of m holding bits of w: upward by a carry, downward bit by bit
+        w = (((m+w)^m)|w)&m;
+        for(uint64_t v; (v = (w|w>>1)&m)!=w; w = v);
+        return w;
+    };
+    r[0] = spread(s[0],s[0]);
+    for(int x=1; x<N; x++) r[x] = 0;
+    bool changed = true;
+    while(changed){
+        changed = false;
+        for(int x=1; x<N; x++){ // downward sweep
+            uint64_t w = (r[x]|r[x-1]|r[x-1]>>1)&s[x];
+            if(w!=r[x]){
+                r[x] = spread(w,s[x]);
+                changed = true;
+            }
+        }
+        if(r[N-1]) return 1;
+        for(int x=N-2; x>0; x--){ // upward sweep
+            uint64_t w = (r[x]|r[x+1]|r[x+1]<<1)&s[x];
+            if(w!=r[x]){
+                r[x] = spread(w,s[x]);
+                changed = true;
+            }
+        }
+    }
+    return 2;
+}
+
+/******************************************************************************/
+/* playout kernel (fill the board at random, one win check at the end) */
+// common board dimensions finish playouts with a fixedFinish instance, chosen
+// once by the constructor; other dimensions use the bitboard flood fill
+class Playout{
+private:
+    int size; // dimension of board
+    int cells; // num of empty points
+    long long playouts; // num of playouts run
+    Bitboard stones1,stones2; // position to play out from
+    Bitboard stones1Sim,reach; // simulation workspace
+    Bitboard northEdge,southEdge; // bitboards of player 1's edges
+    vector<point> emptyPoints; // empty points (first cells entries valid)
+    vector<int> index; // position of each point in emptyPoints
+    int (*finish)(const Bitboard&, const point*, int, int); // fixed-size finish of this dimension (0 if none)
+public:
+    /**** constructors ****/
+    Playout(int size);
+    /**** accessors ****/
+    int getCells();
+    long long getPlayouts();
+    const point& getEmpty(int i);
+    /**** mutators ****/
+    void setPosition(const Bitboard& player1Stones, const Bitboard& player2Stones);
+    void play(int id, const point& p);
+    int run(int toMove, mt19937_64& rng);
+};
+
+/**** constructors ****/
+
+Playout::Playout(int size):stones1(size),stones2(size),stones1Sim(size),reach(size),
+northEdge(size),southEdge(size),emptyPoints(size*size),index(size*size){
+    // all buffers allocated here, none in setPosition/play/run
+    STATS_COUNT(statAllocations,1);
+    this->size = size;
+    this->cells = 0;
+    this->playouts = 0;
+    northEdge.fillRow(0);
+    southEdge.fillRow(size-1);
+    switch(size){
+        case 5: finish = fixedFinish<5>; break;
+        case 7: finish = fixedFinish<7>; break;
+        case 9: finish = fixedFinish<9>; break;
+        case 11: finish = fixedFinish<11>; break;
+        case 13: finish = fixedFinish<13>; break;
+        case 19: finish = fixedFinish<19>; break;
+        default: finish = 0;
+    }
+}
+
+/**** accessors ****/
+
+int Playout::getCells(){
+    // num of empty points
+    return cells;
+}
+
+long long Playout::getPlayouts(){
+    // num of playouts run so far
+    return playouts;
+}
+
+const point& Playout::getEmpty(int i){
+    // i-th empty point (after run: i-th point filled, even i by the player who moved first)
+    return emptyPoints[i];
+}
+
+/**** mutators ****/
+
+void Playout::setPosition(const Bitboard& player1Stones, const Bitboard& player2Stones){
+    // copy position and collect its empty points
+    stones1 = player1Stones;
+    stones2 = player2Stones;
+    cells = 0;
+    for(int x=0; x<size; x++)
+        for(int y=0; y<size; y++)
+            if(!stones1.test(point(x,y)) && !stones2.test(point(x,y))){
+                index[size*x+y] = cells;
+                emptyPoints[cells++] = point(x,y);
+            }
+}
+
+void Playout::play(int id, const point& p){
+    // place a stone of player id on empty point p (swap-remove from empty points)
+    int i = index[size*p.x+p.y];
+    point last = emptyPoints[--cells];
+    emptyPoints[i] = last;
+    index[size*last.x+last.y] = i;
+    emptyPoints[cells] = p;
+    index[size*p.x+p.y] = cells;
+    if(id==1) stones1.set(p);
+    else stones2.set(p);
+}
+
+int Playout::run(int toMove, mt19937_64& rng){
+    // fill all empty points alternately from toMove in random order, return winner
+    // a full board has exactly one winner, so only player 1's connection is checked
+    STATS_COUNT(statPlayouts,1);
+    STATS_TIMER(phaseSimulation);
+    for(int i=cells-1; i>0; i--) // Fisher-Yates shuffle
+        swap(emptyPoints[i],emptyPoints[rng()%(i+1)]);
+    for(int i=0; i<cells; i++) index[size*emptyPoints[i].x+emptyPoints[i].y] = i;
+    playouts++;
+    if(finish) return finish(stones1,emptyPoints.data(),cells,(toMove==1)?0:1);
+    stones1Sim = stones1;
+    for(int i=(toMove==1)?0:1; i<cells; i+=2) stones1Sim.set(emptyPoints[i]);
+    return stones1Sim.connects(northEdge,southEdge,reach)? 1 : 2;
+}
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef RECORD
+#define RECORD
+#include "util.cpp"
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/******************************************************************************/
+/* game records (binary file of finished games, appended one by one, memory-mapped for reading) */
+// file layout: the magic "HEXGAME1", then one record per game:
+//   varint length of the rest of the record (so a reader can skip a game unread)
+//   varint size, byte first player | winner<<2, byte strategy of player 1, byte strategy of player 2,
+//   varint ms of player 1's moves, varint ms of player 2's moves,
+//   varint num of moves, varint graph node of each move in order of play
+// Varints are little-endian base 128, so the moves of boards up to 11*11 take one byte each.
+struct gameRecord{
+    int size; // dimension of board
+    int firstPlayer; // player who moved first (1 or 2)
+    int winner; // winner (1 or 2, 0 if unfinished)
+    int strategy[3]; // machine strategy of player 1 and 2 (0: human)
+    long long ms[3]; // time of the moves of player 1 and 2 (ms)
+    vector<int> moves; // graph nodes of the moves, in order of play
+};
+
+const char recordMagic[8] = {'H','E','X','G','A','M','E','1'};
+
+/******************************************************************************/
+/* record writer (appends records to a file, shared by concurrent games) */
+class recordWriter{
+private:
+    ofstream file;
+    long long games; // num of records written
+    string body,buffer; // encoding of the current record without and with its length (reused)
+    mutex lock; // guard of file
+    void putVarint(string& out, uint64_t v);
+public:
+    /**** constructors ****/
+    recordWriter();
+    recordWriter(const recordWriter&) = delete;
+    recordWriter& operator=(const recordWriter&) = delete;
+    /**** accessors ****/
+    bool isOpen();
+    long long getGames();
+    /**** mutators ****/
+    bool open(const string& path);
+    void write(const gameRecord& record);
+};
+
+/**** constructors ****/
+
+recordWriter::recordWriter():games(0){}
+
+/**** helper functions ****/
+
+void recordWriter::putVarint(string& out, uint64_t v){
+    // append v in base 128, low bits first, high bit set on all but the last byte
+    while(v>=128){
+        out.push_back(static_cast<char>((v&127)|128));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+/**** accessors ****/
+
+bool recordWriter::isOpen(){
+    return file.is_open();
+}
+
+long long recordWriter::getGames(){
+    return games;
+}
+
+/**** mutators ****/
+
+bool recordWriter::open(const string& path){
+    // open record file of path for appending (a new file starts with the magic),
+    // false if an existing file is not a record file
+    struct stat st;
+    bool fresh = stat(path.c_str(),&st)!=0 || st.st_size==0;
+    if(!fresh){
+        char magic[8];
+        ifstream existing(path,ios::binary);
+        if(!existing.read(magic,8) || memcmp(magic,recordMagic,8)!=0) return false;
+    }
+    file.open(path,ios::binary|ios::app);
+    if(fresh && file) file.write(recordMagic,8);
+    games = 0;
+    return static_cast<bool>(file);
+}
+
+void recordWriter::write(const gameRecord& record){
+    // append one record (thread-safe), flushed so that a stopped run keeps its games
+    lock_guard<mutex> guard(lock);
+    body.clear();
+    putVarint(body,record.size);
+    body.push_back(static_cast<char>(record.firstPlayer|record.winner<<2));
+    body.push_back(static_cast<char>(record.strategy[1]));
+    body.push_back(static_cast<char>(record.strategy[2]));
+    putVarint(body,record.ms[1]);
+    putVarint(body,record.ms[2]);
+    putVarint(body,record.moves.size());
+    for(auto m:record.moves) putVarint(body,m);
+    buffer.clear();
+    putVarint(buffer,body.size());
+    buffer += body;
+    file.write(buffer.data(),buffer.size());
+    file.flush();
+    games++;
+}
+
+/******************************************************************************/
+/* record reader (scans a memory-mapped record file from the start) */
+class recordReader{
+private:
+    void* mapped; // mapped file (0 if not open)
+    size_t bytes; // length of mapped file
+    const uint8_t* next; // start of the next record
+    const uint8_t* end; // end of file
+    bool getVarint(const uint8_t*& p, const uint8_t* stop, uint64_t& v);
+public:
+    /**** constructors ****/
+    recordReader();
+    recordReader(const recordReader&) = delete;
+    recordReader& operator=(const recordReader&) = delete;
+    /**** destructor ****/
+    ~recordReader();
+    /**** accessors ****/
+    bool isOpen();
+    size_t getBytes();
+    /**** mutators ****/
+    bool open(const string& path);
+    void close();
+    bool read(gameRecord& record);
+    bool skip();
+};
+
+/**** constructors ****/
+
+recordReader::recordReader():mapped(0),bytes(0),next(0),end(0){}
+
+/**** destructor ****/
+
+recordReader::~recordReader(){
+    close();
+}
+
+/**** helper functions ****/
+
+bool recordReader::getVarint(const uint8_t*& p, const uint8_t* stop, uint64_t& v){
+    // decode a varint at p (advanced past it), false if it runs beyond stop
+    v = 0;
+    for(int shift=0; p<stop && shift<64; shift+=7){
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b&127)<<shift;
+        if(!(b&128)) return true;
+    }
+    return false;
+}
+
+/**** accessors ****/
+
+bool recordReader::isOpen(){
+    return mapped!=0;
+}
+
+size_t recordReader::getBytes(){
+    // length of the file
+    return bytes;
+}
+
+/**** mutators ****/
+
+bool recordReader::open(const string& path){
+    // map record file of path, positioned at its first record (false if missing or not a record file)
+    close();
+    int fd = ::open(path.c_str(),O_RDONLY);
+    if(fd<0) return false;
+    struct stat st;
+    if(fstat(fd,&st)<0 || static_cast<size_t>(st.st_size)<8){
+        ::close(fd);
+        return false;
+    }
+    bytes = st.st_size;
+    mapped = mmap(0,bytes,PROT_READ,MAP_PRIVATE,fd,0);
+    ::close(fd); // mapping stays valid
+    if(mapped==MAP_FAILED){
+        mapped = 0;
+        return false;
+    }
+    madvise(mapped,bytes,MADV_SEQUENTIAL);
+    if(memcmp(mapped,recordMagic,8)!=0){
+        close();
+        return false;
+    }
+    next = static_cast<const uint8_t*>(mapped)+8;
+    end = static_cast<const uint8_t*>(mapped)+bytes;
+    return true;
+}
+
+void recordReader::close(){
+    // unmap record file
+    if(mapped) munmap(mapped,bytes);
+    mapped = 0;
+    next = end = 0;
+    bytes = 0;
+}
+
+bool recordReader::read(gameRecord& record){
+    // decode the next record (reuses record's move buffer), false at the end or at a truncated record
+    const uint8_t* p = next;
+    uint64_t length, v, count;
+    if(!getVarint(p,end,length) || length>static_cast<size_t>(end-p)) return false;
+    const uint8_t* stop = p+length;
+    if(!getVarint(p,stop,v) || stop-p<3) return false;
+    record.size = v;
+    record.firstPlayer = p[0]&3;
+    record.winner = p[0]>>2;
+    record.strategy[0] = 0;
+    record.strategy[1] = p[1];
+    record.strategy[2] = p[2];
+    p += 3;
+    record.ms[0] = 0;
+    if(!getVarint(p,stop,v)) return false;
+    record.ms[1] = v;
+    if(!getVarint(p,stop,v)) return false;
+    record.ms[2] = v;
+    if(!getVarint(p,stop,count) || count>static_cast<size_t>(stop-p)) return false;
+    record.moves.resize(count);
+    for(auto& m:record.moves){
+        if(!getVarint(p,stop,v)) return false;
+        m = v;
+    }
+    next = stop;
+    return true;
+}
+
+bool recordReader::skip(){
+    // step over the next record without decoding it, false at the end
+    const uint8_t* p = next;
+    uint64_t length;
+    if(!getVarint(p,end,length) || length>static_cast<size_t>(end-p)) return false;
+    next = p+length;
+    return true;
+}
+
+#endif
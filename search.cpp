@@ -0,0 +1,232 @@
+#ifndef SEARCH
+#define SEARCH
+#include "stats.cpp"
+
+const int winValue=1000000; // search value of a won position (less the plies to win)
+const int winBound=winValue/2; // values beyond +-winBound are wins or losses (heuristic values stay below)
+
+inline int toTableValue(int value, int ply){
+    // value of a node at ply for the transposition table: plies to a win or loss counted from the node
+    return (value>=winBound)? value+ply : (value<=-winBound)? value-ply : value;
+}
+
+inline int fromTableValue(int value, int ply){
+    // value of a table entry at a node at ply: plies to a win or loss counted from the root
+    return (value>=winBound)? value-ply : (value<=-winBound)? value+ply : value;
+}
+
+/******************************************************************************/
+/* Zobrist keys (one random key per board point per player) */
+class zobristKeys{
+private:
+    vector<uint64_t> keys; // keys of player 1 then player 2
+    int cells; // num of board points
+public:
+    /**** constructors ****/
+    zobristKeys();
+    zobristKeys(int cells);
+    /**** accessors ****/
+    uint64_t key(int id, int n);
+};
+
+/**** constructors ****/
+
+zobristKeys::zobristKeys():cells(0){}
+
+zobristKeys::zobristKeys(int cells):keys(2*cells){
+    // keys are fixed for a board size (same hash across runs)
+    this->cells = cells;
+    for(int i=0; i<2*cells; i++) keys[i] = splitmix64(0x5a17ULL*cells+i);
+}
+
+/**** accessors ****/
+
+inline uint64_t zobristKeys::key(int id, int n){
+    // key of player id's stone on graph node n
+    return keys[(id-1)*cells+n];
+}
+
+/******************************************************************************/
+/* transposition table (fixed size, always replace) */
+struct ttEntry{
+    uint64_t key; // full hash of position (0 if empty)
+    int value; // search value for the player to move
+    int16_t depth; // remaining depth of search
+    int16_t move; // best graph node found (-1 if none)
+    uint8_t flag; // bound type: 0. exact, 1. lower bound, 2. upper bound
+};
+
+class transpositionTable{
+private:
+    vector<ttEntry> table; // entries, indexed by low bits of key
+    uint64_t mask; // table size - 1
+    long long probes; // num of probes
+    long long hits; // num of probes that found the position
+public:
+    /**** constructors ****/
+    transpositionTable();
+    /**** accessors ****/
+    bool isEmpty();
+    long long getProbes();
+    long long getHits();
+    double getHitRate();
+    size_t getBytes();
+    ttEntry* probe(uint64_t key);
+    /**** mutators ****/
+    void resize(int bits);
+    void clear();
+    void resetStats();
+    void store(uint64_t key, int depth, int value, int flag, int move);
+};
+
+/**** constructors ****/
+
+transpositionTable::transpositionTable():mask(0),probes(0),hits(0){}
+
+/**** accessors ****/
+
+bool transpositionTable::isEmpty(){
+    // check if table has no storage
+    return table.empty();
+}
+
+long long transpositionTable::getProbes(){
+    return probes;
+}
+
+long long transpositionTable::getHits(){
+    return hits;
+}
+
+double transpositionTable::getHitRate(){
+    // fraction of probes that found the position
+    return probes? static_cast<double>(hits)/probes : 0;
+}
+
+size_t transpositionTable::getBytes(){
+    // memory used by entries
+    return table.size()*sizeof(ttEntry);
+}
+
+ttEntry* transpositionTable::probe(uint64_t key){
+    // entry of position key (0 if absent)
+    probes++;
+    ttEntry& e = table[key&mask];
+    if(e.key!=key) return 0;
+    hits++;
+    return &e;
+}
+
+/**** mutators ****/
+
+void transpositionTable::resize(int bits){
+    // allocate 2^bits entries
+    STATS_COUNT(statAllocations,1);
+    table.assign(1ULL<<bits,ttEntry());
+    mask = (1ULL<<bits)-1;
+    clear();
+}
+
+void transpositionTable::clear(){
+    // empty all entries
+    for(auto& e:table){
+        e.key = 0;
+        e.move = -1;
+    }
+    resetStats();
+}
+
+void transpositionTable::resetStats(){
+    probes = hits = 0;
+}
+
+void transpositionTable::store(uint64_t key, int depth, int value, int flag, int move){
+    // save search result of position key
+    ttEntry& e = table[key&mask];
+    e.key = key;
+    e.value = value;
+    e.depth = depth;
+    e.move = move;
+    e.flag = flag;
+}
+
+/******************************************************************************/
+/* proof-number table (two entries per bucket, keeps the one with more work) */
+const uint32_t pnInf=1000000000; // infinite proof/disproof number
+
+struct pnEntry{
+    uint64_t key; // full hash of position and player to move (0 if empty)
+    uint32_t phi; // proof number of the player to move (0: proven win)
+    uint32_t delta; // disproof number of the player to move (0: proven loss)
+    uint64_t work; // num of nodes searched to get phi and delta
+};
+
+class pnTable{
+private:
+    vector<pnEntry> table; // buckets of two entries, indexed by low bits of key
+    uint64_t mask; // num of buckets - 1
+public:
+    /**** constructors ****/
+    pnTable();
+    /**** accessors ****/
+    bool isEmpty();
+    size_t getBytes();
+    pnEntry* probe(uint64_t key);
+    /**** mutators ****/
+    void resize(int bits);
+    void clear();
+    void store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work);
+};
+
+/**** constructors ****/
+
+pnTable::pnTable():mask(0){}
+
+/**** accessors ****/
+
+bool pnTable::isEmpty(){
+    return table.empty();
+}
+
+size_t pnTable::getBytes(){
+    // memory used by entries
+    return table.size()*sizeof(pnEntry);
+}
+
+pnEntry* pnTable::probe(uint64_t key){
+    // entry of position key (0 if absent)
+    pnEntry* b = &table[2*(key&mask)];
+    if(b[0].key==key) return &b[0];
+    if(b[1].key==key) return &b[1];
+    return 0;
+}
+
+/**** mutators ****/
+
+void pnTable::resize(int bits){
+    // allocate 2^bits entries
+    STATS_COUNT(statAllocations,1);
+    table.assign(1ULL<<bits,pnEntry());
+    mask = (1ULL<<(bits-1))-1;
+    clear();
+}
+
+void pnTable::clear(){
+    // empty all entries
+    for(auto& e:table){
+        e.key = 0;
+        e.work = 0;
+    }
+}
+
+void pnTable::store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work){
+    // save proof and disproof numbers of position key
+    pnEntry* b = &table[2*(key&mask)];
+    pnEntry& e = (b[0].key==key)? b[0] : (b[1].key==key)? b[1] : (b[0].work<=b[1].work)? b[0] : b[1];
+    e.key = key;
+    e.phi = phi;
+    e.delta = delta;
+    e.work = work;
+}
+
+#endif
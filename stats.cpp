@@ -0,0 +1,223 @@
+#ifndef STATS
+#define STATS
+#include "util.cpp"
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+/******************************************************************************/
+/* instrumentation: event counters, phase timers and move latency histograms */
+// compiled in with -DHEX_STATS; otherwise the STATS_ macros expand to nothing
+// and the hot paths carry no instrumentation at all.
+// Counts go to the statsBlock active on the calling thread (set by the game
+// for its machine moves, inherited by worker pool threads), so concurrent
+// games of a tournament keep separate statistics.
+
+enum statsCounter{statPlayouts,statGraphSearches,statAllocations,statNodes,statCircuitSolves,statCounters};
+enum statsPhase{phaseSimulation,phaseMCTS,phaseAlphaBeta,phaseEvaluation,phaseGraphSearch,statPhases};
+const char* const counterNames[] = {"playouts","graph_searches","allocations","nodes_expanded","circuit_solves"};
+const char* const phaseNames[] = {"simulation","mcts","alpha_beta","evaluation","graph_search"};
+
+/******************************************************************************/
+/* latency histogram (power-of-two buckets in microseconds) */
+class latencyHistogram{
+private:
+    static const int buckets=32; // bucket k counts latencies in [2^k,2^(k+1)) us (bucket 0 also below 1 us)
+    long long counts[buckets];
+    long long total; // num of samples
+    double sum,maxValue; // sum and max of samples (ms)
+public:
+    /**** constructors ****/
+    latencyHistogram();
+    /**** accessors ****/
+    long long getCount();
+    double getMean();
+    double getMax();
+    double percentile(double q);
+    void writeJson(ostream& out);
+    /**** mutators ****/
+    void clear();
+    void add(double ms);
+};
+
+/**** constructors ****/
+
+latencyHistogram::latencyHistogram(){
+    clear();
+}
+
+/**** accessors ****/
+
+long long latencyHistogram::getCount(){
+    return total;
+}
+
+double latencyHistogram::getMean(){
+    // mean latency (ms)
+    return total? sum/total : 0;
+}
+
+double latencyHistogram::getMax(){
+    // max latency (ms)
+    return maxValue;
+}
+
+double latencyHistogram::percentile(double q){
+    // upper bound of the q-th quantile (ms), from the bucket it falls in
+    long long rank = static_cast<long long>(ceil(q*total)), seen = 0;
+    for(int k=0; k<buckets; k++){
+        seen += counts[k];
+        if(seen>=rank && seen>0) return min(ldexp(1.,k+1)/1000,maxValue);
+    }
+    return maxValue;
+}
+
+void latencyHistogram::writeJson(ostream& out){
+    // {"count":..,"mean_ms":..,"p50_ms":..,...,"buckets_us":[[lower bound,count],...]}
+    out << "{\"count\":" << total << ",\"mean_ms\":" << getMean() << ",\"p50_ms\":" << percentile(0.5)
+    << ",\"p90_ms\":" << percentile(0.9) << ",\"p99_ms\":" << percentile(0.99) << ",\"max_ms\":" << maxValue
+    << ",\"buckets_us\":[";
+    bool first = true;
+    for(int k=0; k<buckets; k++){
+        if(counts[k]==0) continue;
+        out << (first? "" : ",") << '[' << (k? 1LL<<k : 0) << ',' << counts[k] << ']';
+        first = false;
+    }
+    out << "]}";
+}
+
+/**** mutators ****/
+
+void latencyHistogram::clear(){
+    for(int k=0; k<buckets; k++) counts[k] = 0;
+    total = 0;
+    sum = maxValue = 0;
+}
+
+void latencyHistogram::add(double ms){
+    // record one latency (ms)
+    double us = 1000*ms;
+    int k = (us<2)? 0 : min(static_cast<int>(log2(us)),buckets-1);
+    counts[k]++;
+    total++;
+    sum += ms;
+    maxValue = max(maxValue,ms);
+}
+
+/******************************************************************************/
+/* statistics of one game (shared by the threads searching for it) */
+class statsBlock{
+private:
+    atomic<long long> counts[statCounters]; // events of each counter
+    atomic<long long> phaseNs[statPhases]; // time spent in each phase (ns)
+    atomic<long long> phaseCalls[statPhases]; // num of entries to each phase
+    latencyHistogram latency[3]; // machine move latency of player 1 and 2
+    static mutex outputLock; // guard of the JSON lines output
+public:
+    static thread_local statsBlock* active; // block counted into by the calling thread (0 if none)
+    static string output; // file the JSON lines are appended to (standard error if empty)
+    /**** constructors ****/
+    statsBlock();
+    /**** accessors ****/
+    void writeJson(ostream& out);
+    void writeLine(const string& prefix);
+    /**** mutators ****/
+    void clear();
+    void count(int counter, long long n);
+    void time(int phase, long long ns);
+    void addMove(int id, double ms);
+};
+
+thread_local statsBlock* statsBlock::active = 0;
+string statsBlock::output = "";
+mutex statsBlock::outputLock;
+
+/**** constructors ****/
+
+statsBlock::statsBlock(){
+    clear();
+}
+
+/**** accessors ****/
+
+void statsBlock::writeJson(ostream& out){
+    // "counters":{..},"phases":{..},"move_latency":{..} (fields of a JSON object)
+    out << "\"counters\":{";
+    for(int c=0; c<statCounters; c++)
+        out << (c? "," : "") << '"' << counterNames[c] << "\":" << counts[c].load();
+    out << "},\"phases\":{";
+    for(int p=0; p<statPhases; p++)
+        out << (p? "," : "") << '"' << phaseNames[p] << "\":{\"ms\":" << phaseNs[p].load()/1e6 << ",\"calls\":" << phaseCalls[p].load() << '}';
+    out << "},\"move_latency\":{\"player1\":";
+    latency[1].writeJson(out);
+    out << ",\"player2\":";
+    latency[2].writeJson(out);
+    out << '}';
+}
+
+void statsBlock::writeLine(const string& prefix){
+    // append one JSON line: {prefix,statistics} (prefix: leading fields, may be empty)
+    ostringstream line;
+    line << '{' << prefix << (prefix.empty()? "" : ",");
+    writeJson(line);
+    line << "}\n";
+    lock_guard<mutex> lock(outputLock);
+    if(output.empty()) clog << line.str() << flush;
+    else ofstream(output,ios::app) << line.str();
+}
+
+/**** mutators ****/
+
+void statsBlock::clear(){
+    for(int c=0; c<statCounters; c++) counts[c] = 0;
+    for(int p=0; p<statPhases; p++) phaseNs[p] = phaseCalls[p] = 0;
+    latency[1].clear();
+    latency[2].clear();
+}
+
+inline void statsBlock::count(int counter, long long n){
+    counts[counter].fetch_add(n,memory_order_relaxed);
+}
+
+inline void statsBlock::time(int phase, long long ns){
+    phaseNs[phase].fetch_add(ns,memory_order_relaxed);
+    phaseCalls[phase].fetch_add(1,memory_order_relaxed);
+}
+
+void statsBlock::addMove(int id, double ms){
+    // record latency of a machine move of player id (moves are made by one thread at a time)
+    latency[id].add(ms);
+}
+
+/******************************************************************************/
+/* scoped phase timer (adds the time to its end of scope to the active block) */
+class scopedTimer{
+private:
+    int phase;
+    statsBlock* stats;
+    high_resolution_clock::time_point start;
+public:
+    scopedTimer(int phase);
+    ~scopedTimer();
+};
+
+inline scopedTimer::scopedTimer(int phase):stats(statsBlock::active){
+    this->phase = phase;
+    if(stats) start = high_resolution_clock::now();
+}
+
+inline scopedTimer::~scopedTimer(){
+    if(stats) stats->time(phase,duration_cast<nanoseconds>(high_resolution_clock::now()-start).count());
+}
+
+#ifdef HEX_STATS
+#define STATS_CONCAT(a,b) a##b
+#define STATS_NAME(line) STATS_CONCAT(statsTimer,line)
+#define STATS_COUNT(counter,n) do{if(statsBlock::active) statsBlock::active->count(counter,n);}while(0)
+#define STATS_TIMER(phase) scopedTimer STATS_NAME(__LINE__)(phase)
+#else
+#define STATS_COUNT(counter,n) do{}while(0)
+#define STATS_TIMER(phase) do{}while(0)
+#endif
+
+#endif
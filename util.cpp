@@ -3,10 +3,14 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstdint>
+#include <cmath>
 #include <ctime>
 #include <vector>
 #include <algorithm>
+#include <memory>
 #include <chrono>
+#include <random>
 using namespace std;
 using namespace std::chrono;
 
@@ -15,6 +19,13 @@ const char progressBars[] = {'-','\\','|','/'};
 inline void seperator(int length=20){cout << string(length,'-') << endl;}
 inline double prob(){return static_cast<double>(rand())/RAND_MAX;}
 inline double uniformRand(double min, double max){return min+(max-min)*prob();}
+inline uint64_t splitmix64(uint64_t x){
+    // mix bits of x (used to derive independent seeds)
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+    x = (x^(x>>27))*0x94d049bb133111ebULL;
+    return x^(x>>31);
+}
 bool isInt(string str){
     // check if a string is an int
     for(auto c:str) if(isdigit(c)==false) return false;
@@ -67,13 +78,95 @@ ostream& operator<<(ostream& out, const vector<T>& vec){
 }
 
 /******************************************************************************/
-/* priority queue */
+/* disjoint set (union-find with rollback) */
+class disjointSet{
+private:
+    vector<int> parent; // parent of each element (root points to itself)
+    vector<int> rank; // upper bound of tree height (valid for roots)
+    vector<int> changes; // roots attached by unite, negated if rank of new root grew
+public:
+    /**** constructors ****/
+    disjointSet();
+    disjointSet(int size);
+    /**** accessors ****/
+    int getSize();
+    int findRoot(int n);
+    bool isConnected(int n, int m);
+    int checkpoint();
+    /**** mutators ****/
+    void unite(int n, int m);
+    void rollback(int mark);
+};
+
+/**** constructors ****/
+
+disjointSet::disjointSet(){}
+
+disjointSet::disjointSet(int size):parent(size),rank(size,0){
+    // construct size singleton sets
+    for(int i=0; i<size; i++) parent[i] = i;
+    changes.reserve(size);
+}
+
+/**** accessors ****/
+
+int disjointSet::getSize(){
+    // number of elements
+    return parent.size();
+}
+
+int disjointSet::findRoot(int n){
+    // representative of the set containing n
+    // no path compression (so unite can be rolled back), union by rank keeps trees O(log n) high
+    while(parent[n]!=n) n = parent[n];
+    return n;
+}
+
+bool disjointSet::isConnected(int n, int m){
+    // check if n and m are in the same set
+    return findRoot(n)==findRoot(m);
+}
+
+int disjointSet::checkpoint(){
+    // mark to roll back to
+    return changes.size();
+}
+
+/**** mutators ****/
+
+void disjointSet::unite(int n, int m){
+    // merge sets containing n and m (union by rank)
+    n = findRoot(n);
+    m = findRoot(m);
+    if(n==m) return;
+    if(rank[n]<rank[m]) swap(n,m);
+    parent[m] = n;
+    if(rank[n]==rank[m]){
+        rank[n]++;
+        changes.push_back(-m-1);
+    }else changes.push_back(m);
+}
+
+void disjointSet::rollback(int mark){
+    // undo all unite since checkpoint mark, latest first
+    while(changes.size()>mark){
+        int m = changes.back();
+        changes.pop_back();
+        if(m<0){
+            m = -m-1;
+            rank[parent[m]]--;
+        }
+        parent[m] = m;
+    }
+}
+
+/******************************************************************************/
+/* priority queue (indexed d-ary max-heap) */
 struct node{
     // queue element
     int label;
     double value;
-    node* next;
-    node(int label, double value):label(label),value(value),next(0){}
+    node(int label, double value):label(label),value(value){}
 };
 
 inline ostream& operator<<(ostream& out, const node& n){
@@ -83,12 +176,18 @@ inline ostream& operator<<(ostream& out, const node& n){
 
 class priorityQueue{
 private:
-    node* head;
+    static const int arity=4; // children per heap node
+    vector<node> heap; // heap-ordered nodes
+    vector<long> order; // insertion order of heap nodes (ties: earlier first)
+    vector<int> position; // heap index of each label (-1 if absent)
+    long added; // num of nodes ever added
+    bool higher(int i, int j);
+    void place(int i, const node& n, long o);
+    void siftUp(int i);
+    void siftDown(int i);
 public:
     /**** constructors ****/
     priorityQueue();
-    /**** destructors ****/
-    // ~priorityQueue();
     /**** accessors ****/
     int getSize();
     bool isEmpty();
@@ -97,6 +196,8 @@ public:
     node peekTailNode();
     void print();
     /**** mutators ****/
+    void reserve(int labels);
+    void clear();
     void add(int label, double value);
     void add(node n);
     void del(int label);
@@ -106,79 +207,112 @@ public:
 
 /**** constructors ****/
 
-priorityQueue::priorityQueue():head(0){}
+priorityQueue::priorityQueue():added(0){}
+
+/**** helper functions ****/
+
+inline bool priorityQueue::higher(int i, int j){
+    // check if heap node i has higher priority than heap node j
+    if(heap[i].value!=heap[j].value) return heap[i].value>heap[j].value;
+    return order[i]<order[j];
+}
+
+inline void priorityQueue::place(int i, const node& n, long o){
+    // put node n (inserted o-th) at heap index i
+    heap[i] = n;
+    order[i] = o;
+    position[n.label] = i;
+}
+
+void priorityQueue::siftUp(int i){
+    // move heap node i up until its parent has higher priority
+    node n = heap[i];
+    long o = order[i];
+    while(i>0){
+        int parent = (i-1)/arity;
+        if(heap[parent].value>n.value || (heap[parent].value==n.value && order[parent]<o)) break;
+        place(i,heap[parent],order[parent]);
+        i = parent;
+    }
+    place(i,n,o);
+}
+
+void priorityQueue::siftDown(int i){
+    // move heap node i down until its children have lower priority
+    int size = heap.size();
+    while(true){
+        int best = i;
+        for(int c=arity*i+1; c<=arity*i+arity && c<size; c++)
+            if(higher(c,best)) best = c;
+        if(best==i) break;
+        node n = heap[i];
+        long o = order[i];
+        place(i,heap[best],order[best]);
+        place(best,n,o);
+        i = best;
+    }
+}
 
 /**** accessors ****/
 
 int priorityQueue::getSize(){
     // number of nodes in queue
-    int size = 0;
-    node* p = head;
-    while(p!=0){
-        size++;
-        p = p->next;
-    }
-    return size;
+    return heap.size();
 }
 
 bool priorityQueue::isEmpty(){
     // check if queue is empty
-    if(head==0) return true;
-    return false;
+    return heap.empty();
 }
 
 bool priorityQueue::contains(int label){
     // check if queue contains node as labelled
-    node* p = head;
-    while(p!=0){
-        if(p->label==label) return true;
-        p = p->next;
-    }
-    return false;
+    return label>=0 && label<position.size() && position[label]>=0;
 }
 
 node priorityQueue::peekHeadNode(){
     // return a copy of head node
-    node n(head->label,head->value);
-    return n;
+    return heap[0];
 }
 
 node priorityQueue::peekTailNode(){
-    // return a copy of tail node
-    node* p = head;
-    while(p->next!=0) p = p->next;
-    node n(p->label,p->value);
-    return n;
+    // return a copy of tail node (lowest priority, found among leaves)
+    int tail = heap.size()-1;
+    for(int i=(heap.size()-2)/arity+1; i<heap.size(); i++)
+        if(higher(tail,i)) tail = i;
+    return heap[tail];
 }
 
 void priorityQueue::print(){
-    // print whole queue
-    node* p = head;
-    while(p!=0){
-        cout << *p << " -> ";
-        p = p->next;
-    }
+    // print whole queue in order of priority
+    priorityQueue q = *this;
+    while(!q.isEmpty()) cout << q.popHeadNode() << " -> ";
     cout << "###" << endl;
 }
 
 /**** mutators ****/
 
+void priorityQueue::reserve(int labels){
+    // preallocate storage for labels 0..labels-1
+    heap.reserve(labels);
+    order.reserve(labels);
+    if(position.size()<labels) position.resize(labels,-1);
+}
+
+void priorityQueue::clear(){
+    // remove all nodes (storage kept for reuse)
+    for(auto& n:heap) position[n.label] = -1;
+    heap.clear();
+    order.clear();
+}
+
 void priorityQueue::add(int label, double value){
     // add new node (label,value)
-    node* n = new node(label,value);
-    node* p;
-    if(head==0 || value>head->value){
-        // empty queue or higher priority than head node
-        n->next = head;
-        head = n;
-    }else{
-        p = head;
-        // stop at node with priority just higher than n->value
-        while(p->next!=0 && p->next->value>=value)
-            p = p->next;
-        n->next = p->next;
-        p->next = n;
-    }
+    if(label>=position.size()) position.resize(max(label+1,2*static_cast<int>(position.size())),-1);
+    heap.push_back(node(label,value));
+    order.push_back(added++);
+    position[label] = heap.size()-1;
+    siftUp(heap.size()-1);
 }
 
 void priorityQueue::add(node n){
@@ -188,31 +322,40 @@ void priorityQueue::add(node n){
 
 void priorityQueue::del(int label){
     // delete node as labelled
-    node* p = head;
-    node* prev;
-    if(contains(label)){
-        while(p->label!=label){
-            prev = p;
-            p = p->next;
-        }
-        if(p==head) head = head->next;
-        else prev->next = p->next;
-        free(p);
+    if(!contains(label)) return;
+    int i = position[label];
+    position[label] = -1;
+    int last = heap.size()-1;
+    if(i!=last){
+        int moved = heap[last].label;
+        place(i,heap[last],order[last]);
+        heap.pop_back();
+        order.pop_back();
+        siftUp(i);
+        siftDown(position[moved]);
+    }else{
+        heap.pop_back();
+        order.pop_back();
     }
 }
 
 void priorityQueue::chgPriority(int label, double value){
-    // change priority of node as labelled
-    del(label);
-    add(label,value);
+    // change priority of node as labelled (re-queued behind nodes of equal priority)
+    if(!contains(label)){
+        add(label,value);
+        return;
+    }
+    int i = position[label];
+    heap[i].value = value;
+    order[i] = added++;
+    siftUp(i);
+    siftDown(position[label]);
 }
 
 node priorityQueue::popHeadNode(){
     // pop and return a copy of head node
-    node* p = head;
-    head = head->next;
-    node n(p->label,p->value);
-    free(p);
+    node n = heap[0];
+    del(n.label);
     return n;
 }
 